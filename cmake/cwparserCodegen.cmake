@@ -0,0 +1,30 @@
+# cwparser_generate_loader(<target> SAMPLE <config> HEADER <file.hpp> [NAMESPACE <namespace>])
+#
+# Runs cwparser-codegen on the sample configuration and adds the generated header, with plain structs
+# and a loader specialized to the sample's layout, to <target>. Include it as "<file.hpp>".
+#
+# The tool is the cwparser::codegen target: built in this tree, or imported by find_package(cwparser).
+function(cwparser_generate_loader target)
+    cmake_parse_arguments(ARG "" "SAMPLE;HEADER;NAMESPACE" "" ${ARGN})
+    if(NOT ARG_SAMPLE OR NOT ARG_HEADER)
+        message(FATAL_ERROR "cwparser_generate_loader: SAMPLE and HEADER are required")
+    endif()
+    if(NOT ARG_NAMESPACE)
+        set(ARG_NAMESPACE config)
+    endif()
+
+    get_filename_component(sample "${ARG_SAMPLE}" ABSOLUTE)
+    set(directory "${CMAKE_CURRENT_BINARY_DIR}/cwparser_generated")
+    set(output "${directory}/${ARG_HEADER}")
+
+    add_custom_command(
+        OUTPUT "${output}"
+        COMMAND ${CMAKE_COMMAND} -E make_directory "${directory}"
+        COMMAND $<TARGET_FILE:cwparser::codegen> "${sample}" "${output}" ${ARG_NAMESPACE}
+        DEPENDS cwparser::codegen "${sample}"
+        COMMENT "Generating ${ARG_HEADER} from ${ARG_SAMPLE}"
+        VERBATIM
+    )
+    target_sources(${target} PRIVATE "${output}")
+    target_include_directories(${target} PRIVATE "${directory}")
+endfunction()
@@ -0,0 +1,221 @@
+#pragma once
+
+// Include it explicitly: parallel conversion and parsing on a ThreadPool.
+
+#include <algorithm>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+#include "cwparser.hpp"
+
+namespace cwparser
+{
+
+/**
+ * @brief Gather the properties of several nodes, node by node in key order, for convertParallel.
+ */
+inline std::vector<Selection::Match> collect(const std::vector<const Node *> &nodes)
+{
+	size_t count = 0;
+	for (const Node *node : nodes)
+		count += node->properties.size();
+
+	std::vector<Selection::Match> items;
+	items.reserve(count);
+	for (const Node *node : nodes)
+	{
+		for (const auto &prop : node->properties)
+			items.push_back(Selection::Match{node, prop.first, &prop.second});
+	}
+	return items;
+}
+
+/**
+ * @brief Gather the matches of a query for convertParallel.
+ */
+inline std::vector<Selection::Match> collect(const Selection &selection)
+{
+	std::vector<Selection::Match> items;
+	for (const auto &match : selection)
+		items.push_back(match);
+	return items;
+}
+
+/**
+ * @brief Convert items[i] into out[i] on the pool, out must hold items.size() elements.
+ *
+ * Conversion goes through the non-throwing path, nothing is locked and each worker writes its own slots.
+ * When errors is given errors[i] receives the outcome of items[i].
+ * @return number of items that failed to convert
+ */
+template <typename T>
+size_t convertParallel(const std::vector<Selection::Match> &items, T *out, ThreadPool &pool, Error *errors = nullptr)
+{
+	std::atomic<size_t> failed{0};
+	pool.parallelFor(items.size(), [&](size_t begin, size_t end) {
+		size_t local = 0;
+		for (size_t idx = begin; idx < end; idx++)
+		{
+			const Value &value = *items[idx].value;
+			std::string_view text;
+			_::Status status = items[idx].node->resolve(value, text);
+			if (status)
+				status = _::try_from_string(text, out[idx]);
+			if (!status)
+				local++;
+			if (errors != nullptr)
+				errors[idx] = status ? Error{} : _::locate(value.location, status);
+		}
+		failed += local;
+	});
+	return failed;
+}
+
+namespace _
+{
+
+	struct BatchSlot
+	{
+		uint64_t hash;
+		Symbol key;
+		size_t order;
+	};
+
+	/**
+	 * @brief Sort in one chunk per worker, then merge the chunks pairwise, each round on the pool.
+	 */
+	template <typename T, typename Less>
+	void sortParallel(std::vector<T> &items, Less less, ThreadPool &pool)
+	{
+		size_t chunk = std::max<size_t>(1, (items.size() + pool.size() - 1) / pool.size());
+		size_t chunks = (items.size() + chunk - 1) / chunk;
+		pool.parallelFor(chunks, [&](size_t begin, size_t end) {
+			for (size_t idx = begin; idx < end; idx++)
+				std::sort(items.begin() + idx * chunk, items.begin() + std::min(items.size(), (idx + 1) * chunk), less);
+		}, 1);
+		for (size_t width = chunk; width < items.size(); width *= 2)
+		{
+			size_t pairs = (items.size() + 2 * width - 1) / (2 * width);
+			pool.parallelFor(pairs, [&](size_t begin, size_t end) {
+				for (size_t idx = begin; idx < end; idx++)
+				{
+					size_t low = idx * 2 * width;
+					size_t middle = std::min(items.size(), low + width);
+					size_t high = std::min(items.size(), low + 2 * width);
+					std::inplace_merge(items.begin() + low, items.begin() + middle, items.begin() + high, less);
+				}
+			}, 1);
+		}
+	}
+
+} // namespace _
+
+inline void Node::setValues(std::vector<_::Pending> &batch, ThreadPool &pool, bool typed, size_t min_parallel)
+{
+	refuseShared();
+	if (batch.size() < min_parallel || !properties.empty() || pool.size() < 2 || tree->lock)
+	{
+		for (auto &pending : batch)
+		{
+			Value &stored = setValue(pending.key, std::move(pending.value), pending.location);
+			if (typed && !stored.interpolated)
+			{
+				Scalar scalar;
+				_::classify(stored.text(), scalar);
+				_::WriteGuard guard(tree->lock.get());
+				if (scalar.kind != Scalar::Kind::none || stored.slot != 0)
+					typedSlot(stored) = scalar;
+			}
+		}
+		return;
+	}
+
+	// Interning and classifying the values is independent per entry
+	std::vector<Value> values(batch.size());
+	std::vector<Scalar> scalars(typed ? batch.size() : 0);
+	std::vector<_::BatchSlot> slots(batch.size());
+	pool.parallelFor(batch.size(), [&](size_t begin, size_t end) {
+		for (size_t idx = begin; idx < end; idx++)
+		{
+			Symbol key = tree->interner->intern(batch[idx].key);
+			slots[idx] = {key.hash(), key, idx};
+			values[idx] = Value{std::move(batch[idx].value), batch[idx].location};
+			if (typed && !values[idx].interpolated)
+				_::classify(values[idx].text(), scalars[idx]);
+		}
+	});
+
+	// Map order, duplicates end up next to each other in the order they were read
+	_::sortParallel(slots, [](const _::BatchSlot &a, const _::BatchSlot &b) {
+		if (a.hash != b.hash)
+			return a.hash < b.hash;
+		if (a.key != b.key)
+			return a.key.view() < b.key.view();
+		return a.order < b.order;
+	}, pool);
+
+	auto built = std::make_unique<_::KeyIndex>();
+	built->properties.reserve(slots.size());
+	for (size_t idx = 0; idx < slots.size(); idx++)
+	{
+		if (idx + 1 < slots.size() && slots[idx + 1].key == slots[idx].key)
+			continue;
+		built->properties.push_back(slots[idx].key);
+		Value &value = values[slots[idx].order];
+		if (typed && scalars[slots[idx].order].kind != Scalar::Kind::none)
+			typedSlot(value) = scalars[slots[idx].order];
+		if (digested)
+			properties_digest += _::propertyHash(slots[idx].hash, _::hash(value.text()));
+		if (value.interpolated && tree->references)
+			tree->references->noteInterpolated();
+		if (filter)
+			filter->insert(slots[idx].hash);
+		properties.emplace_hint(properties.end(), slots[idx].key, std::move(value));
+	}
+
+	// The names are at hand and the workers idle, a first query then finds them sorted
+	_::sortParallel(built->properties, [](const Symbol &a, const Symbol &b) { return a.view() < b.view(); }, pool);
+	_::sortedKeys(children, built->children);
+	index.publish(std::move(built));
+	if (tree->references)
+		tree->references->invalidate();
+}
+
+/**
+ * @brief TreeBuilder that holds back the properties of a section and stores them together at its end.
+ */
+struct cwparser::BatchBuilder : TreeBuilder
+{
+	ThreadPool &pool;
+	std::vector<_::Pending> pending;
+
+	void flush()
+	{
+		if (!pending.empty())
+			current->setValues(pending, pool, typed);
+		pending.clear();
+	}
+
+	void on_section_begin(std::string_view name, size_t depth)
+	{
+		flush();
+		TreeBuilder::on_section_begin(name, depth);
+	}
+
+	void on_property(std::string_view key, std::string_view value, Location location)
+	{
+		pending.push_back({std::string(key), std::string(value), location});
+	}
+
+	void on_section_end(std::string_view, size_t) { flush(); }
+};
+
+inline bool cwparser::parse(std::istream &in, ThreadPool &pool)
+{
+	root = std::make_shared<Node>(interner);
+	BatchBuilder builder{{*interner, root, {}, root, eager_typing}, pool, {}};
+	return build(in, builder);
+}
+
+} // namespace cwparser
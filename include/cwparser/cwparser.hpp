@@ -1,131 +1,746 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
-#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <tuple>
+#include <utility>
 #include <type_traits>
+#include <typeinfo>
 #include <unordered_map>
 #include <vector>
 
 #include "ctm_tt.hpp"
+#include "intern.hpp"
+#include "numeric.hpp"
 
 namespace cwparser
 {
+
+enum class ErrorCode : uint8_t
+{
+	ok,
+	missing_key,
+	invalid_value,
+	out_of_range,
+	unmatched_brackets,
+	bad_format,
+	reference_cycle
+};
+
+inline const char *to_string(ErrorCode code)
+{
+	switch (code)
+	{
+	case ErrorCode::ok:                 return "ok";
+	case ErrorCode::missing_key:        return "Missing key";
+	case ErrorCode::invalid_value:      return "Invalid value";
+	case ErrorCode::out_of_range:       return "Value out of range";
+	case ErrorCode::unmatched_brackets: return "Unmatched brackets";
+	case ErrorCode::bad_format:         return "Error on format";
+	case ErrorCode::reference_cycle:    return "Reference cycle";
+	}
+	return "Unknown error";
+}
+
+/**
+ * @brief Position of a property value in its source file, 1-based. Zero means unknown.
+ */
+struct Location
+{
+	uint32_t line = 0;
+	uint32_t column = 0;
+};
+
+struct Error
+{
+	ErrorCode code = ErrorCode::ok;
+	uint32_t line = 0;
+	uint32_t column = 0;
+};
+
+/**
+ * @brief Expected-style return of Node::try_get, holds either a value or an Error.
+ */
+template <typename T>
+class Result
+{
+public:
+	Result(T value) : value_(std::move(value)) {}
+	Result(Error error) : error_(error) {}
+
+	bool has_value() const { return error_.code == ErrorCode::ok; }
+	explicit operator bool() const { return has_value(); }
+
+	T &operator*() { return value_; }
+	const T &operator*() const { return value_; }
+	T *operator->() { return &value_; }
+	const T *operator->() const { return &value_; }
+
+	T &value()
+	{
+		if (!has_value())
+			throw std::runtime_error(to_string(error_.code));
+		return value_;
+	}
+
+	const T &value() const
+	{
+		if (!has_value())
+			throw std::runtime_error(to_string(error_.code));
+		return value_;
+	}
+
+	const Error &error() const { return error_; }
+
+private:
+	T value_{};
+	Error error_;
+};
+
+/**
+ * @brief Number or boolean already converted from a value's text, see Schema, cwparser::setEagerTyping and Node::typed.
+ *
+ * string, tuple and array only tell the shape of the text, which stays the value's text.
+ */
+struct Scalar
+{
+	enum class Kind : uint8_t
+	{
+		none,
+		integer,
+		floating,
+		boolean,
+		string,
+		tuple,
+		array
+	};
+
+	Kind kind = Kind::none;
+	union
+	{
+		long integer;
+		double floating;
+		bool boolean;
+	};
+
+	Scalar() : integer(0) {}
+};
+
+/**
+ * @brief Raw text of a property and where it was read from.
+ *
+ * The text is owned, or after cwparser::deduplicate() held by the tree's interner and shared by every
+ * value with the same text; it then stays valid while the interner is alive, like a Symbol.
+ */
+class Value
+{
+public:
+	Location location;
+	uint32_t slot = 0;         // 1 + index of its converted form in the node's typed slots, 0 when text only
+	bool interpolated = false; // holds ${...} references
+
+	Value() : owned() {}
+	Value(std::string text, Location location = {})
+		: location(location), interpolated(text.find("${") != std::string::npos), owned(std::move(text))
+	{
+	}
+
+	Value(const Value &other) : location(other.location), slot(other.slot), interpolated(other.interpolated)
+	{
+		construct(other);
+	}
+
+	Value(Value &&other) noexcept : location(other.location), slot(other.slot), interpolated(other.interpolated)
+	{
+		if (other.shared_text)
+			construct(other);
+		else
+			new (&owned) std::string(std::move(other.owned));
+	}
+
+	Value &operator=(const Value &other)
+	{
+		if (this != &other)
+		{
+			destroy();
+			construct(other);
+			location = other.location;
+			interpolated = other.interpolated;
+			slot = other.slot;
+		}
+		return *this;
+	}
+
+	Value &operator=(Value &&other) noexcept
+	{
+		if (this != &other)
+		{
+			if (shared_text || other.shared_text)
+			{
+				destroy();
+				if (other.shared_text)
+					construct(other);
+				else
+					new (&owned) std::string(std::move(other.owned));
+			}
+			else
+				owned = std::move(other.owned);
+			location = other.location;
+			interpolated = other.interpolated;
+			slot = other.slot;
+		}
+		return *this;
+	}
+
+	~Value() { destroy(); }
+
+	const std::string &text() const { return shared_text ? shared.str() : owned; }
+	operator const std::string &() const { return text(); }
+	bool empty() const { return text().empty(); }
+
+	/**
+	 * @brief Whether the text is the interner's copy, shared with the values of the same text.
+	 */
+	bool sharesText() const { return shared_text; }
+
+	/**
+	 * @brief Give up the owned text for its copy in interner, see cwparser::deduplicate().
+	 */
+	void shareText(Interner &interner)
+	{
+		if (shared_text)
+			return;
+		Symbol text = interner.intern(owned);
+		destroy();
+		new (&shared) Symbol(text);
+		shared_text = true;
+	}
+
+private:
+	bool shared_text = false; // packs beside interpolated
+	union
+	{
+		std::string owned;
+		Symbol shared;
+	};
+
+	void construct(const Value &other)
+	{
+		if (other.shared_text)
+			new (&shared) Symbol(other.shared);
+		else
+			new (&owned) std::string(other.owned);
+		shared_text = other.shared_text;
+	}
+
+	void destroy()
+	{
+		if (!shared_text)
+			owned.~basic_string();
+		shared_text = false;
+	}
+};
+
+/**
+ * @brief Specialize to read an enum with get<E>(), names are matched exactly:
+ * @code
+ * template <> struct cwparser::enum_names<Mode> {
+ *     static constexpr std::pair<std::string_view, Mode> values[] = {{"fast", Mode::fast}, {"safe", Mode::safe}};
+ * };
+ * @endcode
+ * A perfect hash table over the names is built at compile time, a lookup costs one hash and one compare.
+ */
+template <typename E>
+struct enum_names;
+
+class Node;
+
+template <typename E, typename = void>
+struct has_enum_names : std::false_type
+{
+};
+
+template <typename E>
+struct has_enum_names<E, std::void_t<decltype(enum_names<E>::values)>> : std::true_type
+{
+};
+
 namespace _
 {
 
+	/**
+	 * @brief Outcome of a non-throwing conversion; offset points at the offending character.
+	 */
+	struct Status
+	{
+		ErrorCode code = ErrorCode::ok;
+		size_t offset = 0;
+
+		explicit operator bool() const { return code == ErrorCode::ok; }
+	};
+
+	size_t inline skipSpaces(std::string_view str, size_t pos = 0)
+	{
+		while (pos < str.size() && (str[pos] == ' ' || str[pos] == '\t'))
+			pos++;
+		return pos;
+	}
+
+	std::string_view inline trim(std::string_view str)
+	{
+		const auto start = str.find_first_not_of(" \t");
+		if (start == std::string_view::npos)
+			return str.substr(str.size());
+		const auto end = str.find_last_not_of(" \t");
+		return str.substr(start, end - start + 1);
+	}
+
+	/**
+	 *  Containers nest in any order, declare them before their definitions
+	 */
+	template <typename T>
+	typename std::enable_if<is_specialization_of<std::tuple, T>::value, Status>::type
+	try_from_string(std::string_view value, T &tuple);
+
+	template <typename T>
+	typename std::enable_if<is_specialization_of<std::vector, T>::value && !is_specialization_of<std::vector, typename T::value_type>::value, Status>::type
+	try_from_string(std::string_view str, T &ret);
+
+	template <typename T>
+	typename std::enable_if<is_specialization_of<std::vector, T>::value && is_specialization_of<std::vector, typename T::value_type>::value, Status>::type
+	try_from_string(std::string_view str, T &ret);
+
 	/**
 	 *  Trivial types
+	 *
+	 *  Numbers follow std::stol/std::stod rules: leading blanks are skipped and
+	 *  trailing characters after a valid prefix are ignored.
 	 */
 
 	template <typename T>
-	typename std::enable_if<std::is_integral<T>::value, T>::type
-	inline get_from_string(std::string str)
+	typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, Status>::type
+	inline try_from_string(std::string_view str, T &out)
 	{
-		if (str[1] != 'x' && str[1] != 'X')
-			return std::stol(str);
-		else
-			return std::stol(str, nullptr, 16);
+		size_t pos = skipSpaces(str);
+		bool negative = false;
+		if (pos < str.size() && (str[pos] == '-' || str[pos] == '+'))
+			negative = str[pos++] == '-';
+
+		int base = 10;
+		if (pos + 1 < str.size() && str[pos] == '0' && (str[pos + 1] == 'x' || str[pos + 1] == 'X'))
+		{
+			base = 16;
+			pos += 2;
+		}
+
+		unsigned long magnitude = 0;
+		auto res = std::from_chars(str.data() + pos, str.data() + str.size(), magnitude, base);
+		if (res.ec == std::errc::invalid_argument)
+			return {ErrorCode::invalid_value, pos};
+		constexpr unsigned long limit = std::numeric_limits<long>::max();
+		if (res.ec == std::errc::result_out_of_range || magnitude > limit + (negative ? 1 : 0))
+			return {ErrorCode::out_of_range, pos};
+
+		out = static_cast<T>(negative ? static_cast<long>(0ul - magnitude) : static_cast<long>(magnitude));
+		return {};
 	}
 
 	template <typename T>
-	typename std::enable_if<std::is_floating_point<T>::value, T>::type
-	inline get_from_string(std::string str)
+	typename std::enable_if<std::is_floating_point<T>::value, Status>::type
+	inline try_from_string(std::string_view str, T &out)
 	{
-		return std::stod(str);
+		size_t pos = skipSpaces(str);
+		if (pos + 1 < str.size() && str[pos] == '+' && str[pos + 1] != '-')
+			pos++;
+
+		double value = 0;
+		auto res = std::from_chars(str.data() + pos, str.data() + str.size(), value);
+		if (res.ec == std::errc::invalid_argument)
+			return {ErrorCode::invalid_value, pos};
+		if (res.ec == std::errc::result_out_of_range)
+			return {ErrorCode::out_of_range, pos};
+
+		out = static_cast<T>(value);
+		return {};
 	}
 
 	template <typename T>
-	typename std::enable_if<std::is_same<T, std::string>::value, T>::type
-	inline get_from_string(std::string str)
+	typename std::enable_if<std::is_same<T, std::string>::value, Status>::type
+	inline try_from_string(std::string_view str, T &out)
 	{
 		auto first = str.find('"'), second = str.find('"', first + 1);
-		if (first != std::string::npos && second != std::string::npos)
-			return str.substr(first + 1, second - 1);
-		return str;
+		if (first != std::string_view::npos && second != std::string_view::npos)
+			out.assign(str.substr(first + 1, second - first - 1));
+		else
+			out.assign(str);
+		return {};
 	}
 
 	/**
-	 * @brief Parse string to tuple c++11 compatible
+	 * @brief true/false, yes/no, on/off or 1/0, any case.
 	 */
-	template<typename Tuple, size_t Index = 0>
-	typename std::enable_if<Index == std::tuple_size<Tuple>::value, void>::type
-	parse_string_to_tuple(std::stringstream &ss, Tuple &tuple) {}
+	template <typename T>
+	typename std::enable_if<std::is_same<T, bool>::value, Status>::type
+	inline try_from_string(std::string_view str, T &out)
+	{
+		std::string_view text = trim(str);
+		char lower[6] = {};
+		if (text.size() >= sizeof(lower))
+			return {ErrorCode::invalid_value, skipSpaces(str)};
+		for (size_t idx = 0; idx < text.size(); idx++)
+			lower[idx] = static_cast<char>(text[idx] >= 'A' && text[idx] <= 'Z' ? text[idx] - 'A' + 'a' : text[idx]);
 
-	template<typename Tuple, size_t Index = 0>
-	typename std::enable_if<Index < std::tuple_size<Tuple>::value, void>::type
-	parse_string_to_tuple(std::stringstream &ss, Tuple &tuple) {
-		std::string token;
-		while (ss.peek() == ' ') ss.get();
-		if (ss.peek() == '"') {
-			ss.get(); // Skip opening quote
-			std::getline(ss, token, '"'); // Read until closing quote
-			if (ss.peek() == ' ') ss.get(); // Skip space after quote
-		} else {
-			ss >> token;
-		}
-		std::get<Index>(tuple) = _::get_from_string<typename std::decay<decltype(std::get<Index>(tuple))>::type>(token);
-		parse_string_to_tuple<Tuple, Index + 1>(ss, tuple);
+		std::string_view word(lower, text.size());
+		if (word == "true" || word == "yes" || word == "on" || word == "1")
+			out = true;
+		else if (word == "false" || word == "no" || word == "off" || word == "0")
+			out = false;
+		else
+			return {ErrorCode::invalid_value, skipSpaces(str)};
+		return {};
 	}
 
+	/**
+	 * @brief Collision-free slots for the names of enum_names<E>, built at compile time.
+	 *
+	 * Hash and displace: names fall into buckets of about two, and each bucket, largest first, looks for a
+	 * displacement that moves all its names to free slots. A lookup hashes once, reads the displacement
+	 * of its bucket and lands on the only slot the name can be in.
+	 */
+	template <typename E>
+	struct EnumTable
+	{
+		static constexpr const auto &entries = enum_names<E>::values;
+		static constexpr size_t count = sizeof(entries) / sizeof(entries[0]);
+
+		static constexpr size_t powerOfTwo(size_t at_least)
+		{
+			size_t size = 1;
+			while (size < at_least)
+				size <<= 1;
+			return size;
+		}
+		static constexpr size_t size = powerOfTwo(count * 2);
+		static constexpr size_t buckets = powerOfTwo((count + 1) / 2);
+		// Buckets need a few tries at half load, running out means a broken hash
+		static constexpr uint32_t max_displacement = 1u << 12;
+
+		struct Table
+		{
+			uint32_t displacements[buckets] = {};
+			uint32_t slots[size] = {}; // entry index + 1, 0 when empty
+		};
+
+		// Names are hashed once and spread, the high half picks the bucket, the displaced value the slot
+		static constexpr uint64_t spread(std::string_view name) { return mix(hash(name)); }
+		static constexpr size_t bucketOf(uint64_t key) { return (key >> 32) & (buckets - 1); }
+		static constexpr size_t slotOf(uint64_t key, uint32_t displacement)
+		{
+			return mix(key ^ (displacement * 0x9E3779B97F4A7C15ull)) & (size - 1);
+		}
+
+		static constexpr Table build()
+		{
+			// Counting sort of the names by bucket, every step stays linear in the number of names
+			uint64_t hashes[count] = {};
+			size_t starts[buckets + 1] = {}, members[count] = {};
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				hashes[idx] = spread(entries[idx].first);
+				starts[bucketOf(hashes[idx]) + 1]++;
+			}
+			size_t largest = 0;
+			for (size_t bucket = 0; bucket < buckets; bucket++)
+			{
+				largest = std::max(largest, starts[bucket + 1]);
+				starts[bucket + 1] += starts[bucket];
+			}
+			size_t filled[buckets] = {};
+			for (size_t idx = 0; idx < count; idx++)
+			{
+				size_t bucket = bucketOf(hashes[idx]);
+				members[starts[bucket] + filled[bucket]++] = idx;
+			}
+
+			Table table{};
+			for (size_t length = largest; length > 0; length--)
+			{
+				for (size_t bucket = 0; bucket < buckets; bucket++)
+				{
+					if (starts[bucket + 1] - starts[bucket] != length)
+						continue;
+					const size_t *names = members + starts[bucket];
+					// Equal names share a bucket
+					for (size_t a = 0; a < length; a++)
+					{
+						for (size_t b = 0; b < a; b++)
+						{
+							if (hashes[names[a]] == hashes[names[b]] && entries[names[a]].first == entries[names[b]].first)
+								throw std::logic_error("duplicate name in enum_names");
+						}
+					}
+
+					uint32_t displacement = 0;
+					for (;; displacement++)
+					{
+						if (displacement == max_displacement)
+							throw std::logic_error("no displacement found for enum_names");
+						bool free = true;
+						for (size_t a = 0; a < length && free; a++)
+						{
+							size_t slot = slotOf(hashes[names[a]], displacement);
+							free = table.slots[slot] == 0;
+							for (size_t b = 0; b < a && free; b++)
+								free = slotOf(hashes[names[b]], displacement) != slot;
+						}
+						if (free)
+							break;
+					}
+					table.displacements[bucket] = displacement;
+					for (size_t a = 0; a < length; a++)
+						table.slots[slotOf(hashes[names[a]], displacement)] = static_cast<uint32_t>(names[a] + 1);
+				}
+			}
+			return table;
+		}
+		static constexpr Table table = build();
+
+		static const std::pair<std::string_view, E> *find(std::string_view name)
+		{
+			uint64_t key = spread(name);
+			uint32_t slot = table.slots[slotOf(key, table.displacements[bucketOf(key)])];
+			if (slot == 0 || entries[slot - 1].first != name)
+				return nullptr;
+			return &entries[slot - 1];
+		}
+	};
+
 	template <typename T>
-	typename std::enable_if<is_specialization_of<std::tuple, T>::value, T>::type
-	inline get_from_string(const std::string &value)
+	typename std::enable_if<std::is_enum<T>::value && has_enum_names<T>::value, Status>::type
+	inline try_from_string(std::string_view str, T &out)
+	{
+		const auto *entry = EnumTable<T>::find(trim(str));
+		if (entry == nullptr)
+			return {ErrorCode::invalid_value, skipSpaces(str)};
+		out = entry->second;
+		return {};
+	}
+
+	/**
+	 * Tuples, either space separated `1 3.14 "hello"` or bracketed `[1, 3.14, "hello"]`.
+	 * Elements are scanned in place and converted one by one, the loop is unrolled per element type.
+	 */
+	inline std::string_view unquote(std::string_view token, size_t &offset)
+	{
+		if (token.size() >= 2 && token.front() == '"' && token.back() == '"')
+		{
+			offset++;
+			return token.substr(1, token.size() - 2);
+		}
+		return token;
+	}
+
+	/**
+	 * @brief Next space separated token, quoted tokens may hold spaces.
+	 */
+	inline std::string_view next_spaced(std::string_view str, size_t &pos, size_t &offset)
+	{
+		pos = skipSpaces(str, pos);
+		offset = pos;
+		if (pos < str.size() && str[pos] == '"')
+		{
+			size_t close = str.find('"', pos + 1);
+			offset = pos + 1;
+			std::string_view token = str.substr(pos + 1, close == std::string_view::npos ? std::string_view::npos : close - pos - 1);
+			pos = close == std::string_view::npos ? str.size() : close + 1;
+			return token;
+		}
+		size_t end = str.find_first_of(" \t", pos);
+		if (end == std::string_view::npos)
+			end = str.size();
+		std::string_view token = str.substr(pos, end - pos);
+		pos = end;
+		return token;
+	}
+
+	/**
+	 * @brief Next comma separated element up to the closing bracket, nested brackets and quotes are skipped.
+	 */
+	inline std::string_view next_bracketed(std::string_view str, size_t &pos, size_t close, size_t &offset)
+	{
+		size_t start = pos, level = 0;
+		bool quoted = false;
+		for (; pos < close; pos++)
+		{
+			char c = str[pos];
+			if (c == '"')
+				quoted = !quoted;
+			else if (!quoted && c == '[')
+				level++;
+			else if (!quoted && c == ']')
+				level--;
+			else if (!quoted && level == 0 && c == ',')
+				break;
+		}
+		std::string_view token = trim(str.substr(start, pos - start));
+		offset = token.data() - str.data();
+		if (pos < close)
+			pos++; // Skip the comma
+		return unquote(token, offset);
+	}
+
+	/**
+	 * @brief Index of the bracket closing the one at pos, npos when unbalanced.
+	 */
+	inline size_t closing_bracket(std::string_view str, size_t pos)
 	{
+		size_t level = 0;
+		bool quoted = false;
+		for (; pos < str.size(); pos++)
+		{
+			if (str[pos] == '"')
+				quoted = !quoted;
+			else if (!quoted && str[pos] == '[')
+				level++;
+			else if (!quoted && str[pos] == ']' && --level == 0)
+				return pos;
+		}
+		return std::string_view::npos;
+	}
 
-		std::stringstream ss(value);
-		T tuple;
-	    parse_string_to_tuple(ss, tuple);
+	template <typename Element>
+	bool parse_tuple_element(std::string_view str, size_t &pos, size_t close, Element &element, Status &status)
+	{
+		size_t offset = 0;
+		std::string_view token;
+		if (close == std::string_view::npos)
+			token = next_spaced(str, pos, offset);
+		else if (pos < close)
+			token = next_bracketed(str, pos, close, offset);
+		else
+		{
+			status = {ErrorCode::bad_format, close};
+			return false;
+		}
 
-		return tuple;
+		status = try_from_string(token, element);
+		status.offset += offset;
+		return bool(status);
+	}
+
+	template <typename Tuple, size_t... Index>
+	Status parse_string_to_tuple(std::string_view str, Tuple &tuple, std::index_sequence<Index...>)
+	{
+		size_t pos = skipSpaces(str), close = std::string_view::npos;
+		if (pos < str.size() && str[pos] == '[')
+		{
+			size_t match = closing_bracket(str, pos);
+			if (match != std::string_view::npos && skipSpaces(str, match + 1) == str.size())
+			{
+				close = match;
+				pos++;
+			}
+		}
+
+		Status status;
+		if (!(parse_tuple_element(str, pos, close, std::get<Index>(tuple), status) && ...))
+			return status;
+		if (close != std::string_view::npos && pos < close)
+			return {ErrorCode::bad_format, pos};
+		return status;
+	}
+
+	template <typename T>
+	typename std::enable_if<is_specialization_of<std::tuple, T>::value, Status>::type
+	inline try_from_string(std::string_view value, T &tuple)
+	{
+		return parse_string_to_tuple(value, tuple, std::make_index_sequence<std::tuple_size<T>::value>{});
 	}
 
 
 	/**
-	 *  get_from_string recursive types
+	 *  try_from_string recursive types
 	 */
 	template <typename T>
-	typename std::enable_if<is_specialization_of<std::vector, T>::value && !is_specialization_of<std::vector, typename T::value_type>::value, T>::type
-	inline get_from_string(const std::string &str)
+	typename std::enable_if<is_specialization_of<std::vector, T>::value && !is_specialization_of<std::vector, typename T::value_type>::value, Status>::type
+	inline try_from_string(std::string_view str, T &ret)
 	{
 		size_t first = str.find_first_of("["), second = str.find_last_of("]");
-		if (first == std::string::npos || second == std::string::npos)
-			throw std::runtime_error("Unmatched brackets");
-			
+		if (first == std::string_view::npos || second == std::string_view::npos || second < first)
+			return {ErrorCode::unmatched_brackets, first == std::string_view::npos ? 0 : first};
+
+		ret.clear();
 		first += 1;
 		if (first == second)
-			return T{};
+			return {};
 
-		T ret;
+		using Element = typename T::value_type;
+		if constexpr (std::is_arithmetic<Element>::value && !std::is_same<Element, bool>::value)
+		{
+			// Plain numbers are scanned in place, an element of any other shape and those after it take the loop below
+			const SimdLevel level = simdLevel();
+			const char *pos = str.data() + first, *end = str.data() + second;
+			ret.reserve(countByte(pos, end, ',', level) + 1);
+			while (true)
+			{
+				Element element{};
+				const char *next = nullptr;
+				if constexpr (std::is_integral<Element>::value)
+					next = fastInteger(pos, end, element, level);
+				else
+					next = fastFloating(pos, end, element, level);
+				if (next == nullptr)
+					break;
+				ret.push_back(element);
+				if (next == end)
+					return {};
+				pos = next + 1;
+			}
+			first = static_cast<size_t>(pos - str.data());
+		}
 
 		while (true)
 		{
 			size_t coma = str.find(",", first);
-			ret.emplace_back(get_from_string<typename std::decay<typename T::value_type>::type>(
-				str.substr(first, (coma == std::string::npos) ? second : coma)));
-			first = coma + 1;
-			if (coma == std::string::npos)
+			size_t last = (coma == std::string_view::npos || coma > second) ? second : coma;
+			std::string_view item = str.substr(first, last - first);
+			size_t lead = skipSpaces(item);
+			Status status = try_from_string(_::trim(item), ret.emplace_back());
+			if (!status)
+				return {status.code, first + lead + status.offset};
+			if (last == second)
 				break;
+			first = coma + 1;
 		}
 
-		return ret;
+		return {};
 	};
 
 	template <typename T>
-	typename std::enable_if<is_specialization_of<std::vector, T>::value && is_specialization_of<std::vector, typename T::value_type>::value, T>::type
-	inline get_from_string(const std::string &str)
+	typename std::enable_if<is_specialization_of<std::vector, T>::value && is_specialization_of<std::vector, typename T::value_type>::value, Status>::type
+	inline try_from_string(std::string_view str, T &ret)
 	{
 
-		size_t first = str.find_first_of("["), second = str.size() - 1;
-		if (first == std::string::npos)
-			throw std::runtime_error("Error on format");
+		size_t first = str.find_first_of("[");
+		if (first == std::string_view::npos)
+			return {ErrorCode::bad_format, 0};
 
-		T ret;
+		ret.clear();
 		size_t sub_first = first + 1, sub_second = sub_first;
 		for (size_t idx = first + 1, level = 1; idx < str.size() && level > 0; idx++)
 		{
@@ -141,8 +756,9 @@ namespace _
 				if (level == 1)
 				{
 					sub_second = idx;
-					ret.emplace_back(get_from_string<typename std::decay<typename T::value_type>::type>(
-						str.substr(sub_first, (sub_second - sub_first) + 1)));
+					Status status = try_from_string(str.substr(sub_first, (sub_second - sub_first) + 1), ret.emplace_back());
+					if (!status)
+						return {status.code, sub_first + status.offset};
 				}
 				break;
 			default:
@@ -150,38 +766,735 @@ namespace _
 			}
 		}
 
-		return ret;
+		return {};
+	};
+
+	/**
+	 * @brief Throwing conversion used by Node::get, mirrors the std::sto* exception types.
+	 */
+	[[noreturn]] void inline throw_error(ErrorCode code, const std::string &where = {})
+	{
+		std::string what = std::string(to_string(code)) + where;
+		switch (code)
+		{
+		case ErrorCode::invalid_value:
+			throw std::invalid_argument(what);
+		case ErrorCode::out_of_range:
+			throw std::out_of_range(what);
+		default:
+			throw std::runtime_error(what);
+		}
+	}
+
+	/**
+	 * Typed slots: only numbers and booleans are kept, a slot is read back as the same kind only.
+	 */
+	/**
+	 * @brief Whether a number read at full width is representable in T.
+	 */
+	template <typename T>
+	constexpr bool fitsIn(long value)
+	{
+		if constexpr (std::is_signed<T>::value)
+			return value >= static_cast<long>(std::numeric_limits<T>::min()) &&
+				   static_cast<unsigned long>(value < 0 ? 0 : value) <= static_cast<unsigned long>(std::numeric_limits<T>::max());
+		else
+			return value >= 0 && static_cast<unsigned long>(value) <= static_cast<unsigned long>(std::numeric_limits<T>::max());
+	}
+
+	template <typename T>
+	inline void toScalar(const T &value, Scalar &slot)
+	{
+		if constexpr (std::is_same<T, bool>::value)
+		{
+			slot.kind = Scalar::Kind::boolean;
+			slot.boolean = value;
+		}
+		else if constexpr (std::is_integral<T>::value)
+		{
+			slot.kind = Scalar::Kind::integer;
+			slot.integer = static_cast<long>(value);
+		}
+		else if constexpr (std::is_floating_point<T>::value)
+		{
+			slot.kind = Scalar::Kind::floating;
+			slot.floating = static_cast<double>(value);
+		}
+	}
 
+	template <typename T>
+	inline bool fromScalar(const Scalar &slot, T &out)
+	{
+		if constexpr (std::is_same<T, bool>::value)
+		{
+			if (slot.kind != Scalar::Kind::boolean)
+				return false;
+			out = slot.boolean;
+			return true;
+		}
+		else if constexpr (std::is_integral<T>::value)
+		{
+			if (slot.kind != Scalar::Kind::integer || !fitsIn<T>(slot.integer))
+				return false;
+			out = static_cast<T>(slot.integer);
+			return true;
+		}
+		else if constexpr (std::is_floating_point<T>::value)
+		{
+			if (slot.kind != Scalar::Kind::floating)
+				return false;
+			out = static_cast<T>(slot.floating);
+			return true;
+		}
+		return false;
+	}
+
+	/**
+	 * @brief Shape of a whole value: a number or boolean is only kept when the text holds nothing else,
+	 *        so get() reads the same from the slot as from the text.
+	 */
+	inline void classify(std::string_view str, Scalar &slot)
+	{
+		std::string_view text = trim(str);
+		if (text.empty())
+			return;
+
+		char first = text.front();
+		if (first == '[')
+		{
+			if (closing_bracket(text, 0) == text.size() - 1)
+				slot.kind = Scalar::Kind::array;
+			return;
+		}
+		if (first == '"')
+		{
+			size_t close = text.find('"', 1);
+			if (close == text.size() - 1)
+				slot.kind = Scalar::Kind::string;
+			else if (close != std::string_view::npos)
+				slot.kind = Scalar::Kind::tuple;
+			return;
+		}
+		if (text.find_first_of(" \t") != std::string_view::npos)
+		{
+			slot.kind = Scalar::Kind::tuple;
+			return;
+		}
+
+		bool number = (first >= '0' && first <= '9') || first == '-' || first == '+' || first == '.';
+		if (!number)
+		{
+			bool boolean = false;
+			if (try_from_string(text, boolean))
+				toScalar(boolean, slot);
+			return;
+		}
+
+		// Integers, decimal or 0x hexadecimal, then anything from_chars reads as a double to the last character
+		size_t pos = first == '-' || first == '+' ? 1 : 0;
+		bool hex = pos + 1 < text.size() && text[pos] == '0' && (text[pos + 1] == 'x' || text[pos + 1] == 'X');
+		size_t digits = hex ? pos + 2 : pos;
+		auto isDigit = [hex](char c) { return (c >= '0' && c <= '9') || (hex && ((c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))); };
+		size_t end = digits;
+		while (end < text.size() && isDigit(text[end]))
+			end++;
+		if (end == text.size() && end > digits)
+		{
+			long integer = 0;
+			if (try_from_string(text, integer))
+				toScalar(integer, slot);
+			return;
+		}
+		if (hex || (first == '+' && text.size() > 1 && text[1] == '-'))
+			return;
+
+		double floating = 0;
+		auto res = std::from_chars(text.data() + (first == '+' ? 1 : 0), text.data() + text.size(), floating);
+		if (res.ec == std::errc() && res.ptr == text.data() + text.size())
+			toScalar(floating, slot);
+	}
+
+	template <typename T>
+	inline T get_from_string(std::string_view str)
+	{
+		T value{};
+		Status status = try_from_string(str, value);
+		if (!status)
+			throw_error(status.code);
+		return value;
+	}
+
+	/**
+	 * Tools
+	 */
+	size_t inline countLeadingSpaces(std::string_view str)
+	{
+		auto it = str.find_first_not_of(" \t");
+		size_t ret = 0;
+		if(it == std::string_view::npos)
+			it = str.size();
+		for(size_t i = 0; i < it ; i++)
+		{
+			ret += str[i] == '\t'? 4 : 1;
+		}
 		return ret;
+	}
+
+	/**
+	 * @brief Splits a stream in lines through a fixed window, memory is bounded by the longest line
+	 *        whatever the size of the input.
+	 */
+	class LineReader
+	{
+	public:
+		explicit LineReader(std::istream &in, size_t window = 1 << 16)
+			: in(in), buffer(std::max<size_t>(window, 16))
+		{
+		}
+
+		/**
+		 * @brief Next line without its '\n', the view is valid until the following call.
+		 */
+		bool next(std::string_view &line)
+		{
+			while (true)
+			{
+				const char *newline = static_cast<const char *>(
+					std::memchr(buffer.data() + scanned, '\n', end - scanned));
+				if (newline != nullptr)
+				{
+					size_t stop = newline - buffer.data();
+					line = std::string_view(buffer.data() + begin, stop - begin);
+					begin = scanned = stop + 1;
+					line_no++;
+					return true;
+				}
+				scanned = end;
+
+				if (eof)
+				{
+					if (begin == end)
+						return false;
+					line = std::string_view(buffer.data() + begin, end - begin);
+					begin = end;
+					line_no++;
+					return true;
+				}
+
+				if (begin > 0)
+				{
+					std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+					end -= begin;
+					scanned -= begin;
+					begin = 0;
+				}
+				if (end == buffer.size())
+					buffer.resize(buffer.size() * 2); // A single line wider than the window
+
+				in.read(buffer.data() + end, buffer.size() - end);
+				size_t got = static_cast<size_t>(in.gcount());
+				end += got;
+				eof = got == 0;
+			}
+		}
+
+		uint64_t lineNumber() const { return line_no; }
+
+	private:
+		std::istream &in;
+		std::vector<char> buffer;
+		size_t begin = 0, end = 0, scanned = 0;
+		uint64_t line_no = 0;
+		bool eof = false;
+	};
+
+	/**
+	 * @brief The grammar, shared by cwparser::parse and cwparser::scan.
+	 *
+	 * Properties belong to the last opened section, section headers close the sections
+	 * indented at the same level or deeper.
+	 */
+	template <typename Handler>
+	auto stopRequested(const Handler &handler, int) -> decltype(bool(handler.stop()))
+	{
+		return handler.stop();
+	}
+
+	template <typename Handler>
+	bool stopRequested(const Handler &, long)
+	{
+		return false;
+	}
+
+	template <typename Handler>
+	void tokenize(LineReader &reader, Handler &handler)
+	{
+		std::vector<std::string> sections;
+		std::string_view line;
+		while (!stopRequested(handler, 0) && reader.next(line))
+		{
+			// Count leading spaces to determine level
+			size_t indent = countLeadingSpaces(line);
+			std::string_view text = trim(line);
+
+			if (text.empty() || text[0] == '#')
+				continue;
+
+			// Parse key-value pairs
+			size_t delimiter = text.find(':');
+			if (delimiter != std::string_view::npos && !sections.empty())
+			{
+				std::string_view key = trim(text.substr(0, delimiter));
+				std::string_view value = trim(text.substr(delimiter + 1));
+				uint64_t line_no = std::min<uint64_t>(reader.lineNumber(), std::numeric_limits<uint32_t>::max());
+				uint32_t column = static_cast<uint32_t>(value.data() - line.data()) + 1;
+				handler.on_property(key, value, Location{static_cast<uint32_t>(line_no), column});
+				continue;
+			}
+			// Pop stack until we're at the right level
+			while (!sections.empty() && sections.size() > (indent / 4))
+			{
+				handler.on_section_end(sections.back(), sections.size() - 1);
+				sections.pop_back();
+			}
+
+			// Check for node header [nodeX]
+			if (text[0] == '[' && text.back() == ']')
+			{
+				std::string_view name = text.substr(1, text.length() - 2);
+				handler.on_section_begin(name, sections.size());
+				sections.emplace_back(name);
+			}
+		}
+
+		while (!sections.empty() && !stopRequested(handler, 0))
+		{
+			handler.on_section_end(sections.back(), sections.size() - 1);
+			sections.pop_back();
+		}
+	}
+
+	/**
+	 * @brief Owning pointer for node state allocated only once it is used, copies copy the object.
+	 */
+	template <typename T>
+	class Boxed
+	{
+	public:
+		Boxed() = default;
+		Boxed(const Boxed &other) : ptr(other ? std::make_unique<T>(*other) : nullptr) {}
+		Boxed(Boxed &&) noexcept = default;
+		Boxed &operator=(const Boxed &other)
+		{
+			ptr = other ? std::make_unique<T>(*other) : nullptr;
+			return *this;
+		}
+		Boxed &operator=(Boxed &&) noexcept = default;
+
+		explicit operator bool() const { return ptr != nullptr; }
+		T &operator*() const { return *ptr; }
+		T *operator->() const { return ptr.get(); }
+
+		T &emplace()
+		{
+			ptr = std::make_unique<T>();
+			return *ptr;
+		}
+
+	private:
+		std::unique_ptr<T> ptr;
+	};
+
+	/**
+	 * @brief Property and child names of a node in lexicographic order.
+	 */
+	struct KeyIndex
+	{
+		std::vector<Symbol> properties;
+		std::vector<Symbol> children;
+	};
+
+	/**
+	 * @brief Blocked Bloom filter over key hashes: three bits in one 64 bit word per key, about
+	 *        sixteen bits per key, so a miss is one word load. Empty it lets every key through.
+	 */
+	struct KeyFilter
+	{
+		std::vector<uint64_t> words;
+
+		static uint64_t bits(uint64_t h)
+		{
+			return (uint64_t(1) << ((h >> 32) & 63)) | (uint64_t(1) << ((h >> 38) & 63)) | (uint64_t(1) << ((h >> 44) & 63));
+		}
+
+		void reset(size_t keys)
+		{
+			size_t size = 1;
+			while (size * 4 < keys)
+				size <<= 1;
+			words.assign(size, 0);
+		}
+
+		void insert(uint64_t hash)
+		{
+			if (words.empty())
+				return;
+			uint64_t h = mix(hash);
+			words[h & (words.size() - 1)] |= bits(h);
+		}
+
+		bool mayContain(uint64_t hash) const
+		{
+			if (words.empty())
+				return true;
+			uint64_t h = mix(hash), mask = bits(h);
+			return (words[h & (words.size() - 1)] & mask) == mask;
+		}
+	};
+
+	inline Error locate(Location location, const Status &status)
+	{
+		Error error{status.code, location.line, 0};
+		if (location.column != 0)
+			error.column = location.column + static_cast<uint32_t>(status.offset);
+		return error;
+	}
+
+	inline std::string describe(std::string_view key, Location location, const Status &status)
+	{
+		Error error = locate(location, status);
+		std::string where = " in '" + std::string(key) + "'";
+		if (error.line != 0)
+			where += " at line " + std::to_string(error.line) + ", column " + std::to_string(error.column);
+		return where;
+	}
+
+	/**
+	 * @brief Resolves the ${section.key} references of one tree on demand, see Node::resolve.
+	 *
+	 * The references of a value form the edges of a dependency graph that is walked on the first read only,
+	 * expansions are memoized per value. Shared by every node of a parse, any thread may resolve.
+	 */
+	class References
+	{
+	public:
+		explicit References(std::weak_ptr<const Node> root = {}) : root(std::move(root)) {}
+
+		void setRoot(std::weak_ptr<const Node> tree)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			root = std::move(tree);
+			memo.clear();
+		}
+
+		Status resolve(const Value &value, std::string_view &text);
+
+		/**
+		 * @brief Drop every expansion, a changed value may be referenced from anywhere. Expansions are
+		 *        keyed by value address, so every edit that replaces or frees values calls it.
+		 *
+		 * Edits never run alongside a resolve (single threaded, or under the tree's write lock), so
+		 * while nothing was expanded it returns without locking, as it does for every parsed value.
+		 */
+		void invalidate()
+		{
+			if (!memoized.load(std::memory_order_acquire))
+				return;
+			std::lock_guard<std::mutex> lock(mutex);
+			memo.clear();
+			memoized.store(false, std::memory_order_release);
+		}
+
+		/**
+		 * @brief Whether some value of the tree was ever written with a ${...} reference.
+		 */
+		bool interpolating() const { return used.load(std::memory_order_relaxed); }
+		void noteInterpolated() { used.store(true, std::memory_order_relaxed); }
+
+	private:
+		std::atomic<bool> used{false};
+		std::atomic<bool> memoized{false};
+		std::mutex mutex;
+		std::weak_ptr<const Node> root;
+		std::unordered_map<const Value *, std::string> memo;
+		std::vector<const Value *> visiting;
+
+		Status expand(const Node &tree, const Value &value, const std::string *&out);
+	};
+
+	/**
+	 * @brief Read-mostly lock of a tree shared by threads, see cwparser::setConcurrent.
+	 *
+	 * Each reader thread counts itself in one of several cache line sized slots, so readers never
+	 * write to the same line and, without a writer, enter with one atomic increment. A writer raises
+	 * its flag, then waits for every slot to drain; readers arriving meanwhile step back until it is done.
+	 */
+	class TreeLock
+	{
+	public:
+		void lockShared()
+		{
+			Slot &slot = slots[slotIndex()];
+			while (true)
+			{
+				slot.readers.fetch_add(1, std::memory_order_seq_cst);
+				if (!writing.load(std::memory_order_seq_cst))
+					return;
+				slot.readers.fetch_sub(1, std::memory_order_release);
+				while (writing.load(std::memory_order_acquire))
+					std::this_thread::yield();
+			}
+		}
+
+		void unlockShared() { slots[slotIndex()].readers.fetch_sub(1, std::memory_order_release); }
+
+		void lock()
+		{
+			writers.lock();
+			writing.store(true, std::memory_order_seq_cst);
+			for (const Slot &slot : slots)
+			{
+				while (slot.readers.load(std::memory_order_seq_cst) != 0)
+					std::this_thread::yield();
+			}
+		}
+
+		void unlock()
+		{
+			writing.store(false, std::memory_order_release);
+			writers.unlock();
+		}
+
+	private:
+		struct alignas(64) Slot
+		{
+			std::atomic<uint32_t> readers{0};
+		};
+
+		static size_t slotIndex()
+		{
+			static std::atomic<size_t> threads{0};
+			thread_local const size_t index = threads.fetch_add(1, std::memory_order_relaxed) % slot_count;
+			return index;
+		}
+
+		static constexpr size_t slot_count = 64;
+		Slot slots[slot_count];
+		alignas(64) std::atomic<bool> writing{false};
+		std::mutex writers;
+	};
+
+	/**
+	 * @brief Scoped shared or exclusive hold of a tree lock, nothing when there is none.
+	 */
+	class ReadGuard
+	{
+	public:
+		explicit ReadGuard(TreeLock *lock) : lock(lock)
+		{
+			if (lock != nullptr)
+				lock->lockShared();
+		}
+		~ReadGuard()
+		{
+			if (lock != nullptr)
+				lock->unlockShared();
+		}
+		ReadGuard(const ReadGuard &) = delete;
+		ReadGuard &operator=(const ReadGuard &) = delete;
+
+	private:
+		TreeLock *lock;
+	};
+
+	class WriteGuard
+	{
+	public:
+		explicit WriteGuard(TreeLock *lock) : lock(lock)
+		{
+			if (lock != nullptr)
+				lock->lock();
+		}
+		~WriteGuard()
+		{
+			if (lock != nullptr)
+				lock->unlock();
+		}
+		WriteGuard(const WriteGuard &) = delete;
+		WriteGuard &operator=(const WriteGuard &) = delete;
+
+	private:
+		TreeLock *lock;
+	};
+
+	/**
+	 * @brief What the nodes of one tree share, held once behind Node::tree.
+	 */
+	struct TreeState
+	{
+		std::shared_ptr<Interner> interner;
+		std::shared_ptr<References> references; // set by parse(), null leaves ${...} as written
+		std::shared_ptr<TreeLock> lock;         // set by parse() in concurrent mode, null when single threaded
+	};
+
+	/**
+	 * Fingerprints: a node sums the mixed hashes of its entries, so updates are O(1) and order does not matter.
+	 */
+	constexpr uint64_t propertyHash(uint64_t key, uint64_t value)
+	{
+		return mix(key ^ mix(value));
+	}
+
+	constexpr uint64_t childHash(uint64_t name, uint64_t subtree)
+	{
+		return mix(name + mix(subtree ^ 0x9e3779b97f4a7c15ull));
+	}
+
+	constexpr uint64_t subtreeHash(uint64_t properties, uint64_t children)
+	{
+		return mix(properties ^ mix(children + 0x632be59bd9b4e019ull));
+	}
+
+	template <typename Map>
+	void sortedKeys(const Map &map, std::vector<Symbol> &out)
+	{
+		out.clear();
+		out.reserve(map.size());
+		for (const auto &it : map)
+			out.push_back(it.first);
+		std::sort(out.begin(), out.end(), [](const Symbol &a, const Symbol &b) { return a.view() < b.view(); });
+	}
+
+	/**
+	 * @brief Key index of a node, built by the first query that walks it and dropped when a key is added.
+	 *
+	 * Threads querying a tree nobody edits may race to build it: each builds its own, one is published
+	 * and the others are discarded. Copies start without one.
+	 */
+	class LazyIndex
+	{
+	public:
+		LazyIndex() = default;
+		LazyIndex(const LazyIndex &) {}
+		LazyIndex &operator=(const LazyIndex &)
+		{
+			reset();
+			return *this;
+		}
+		~LazyIndex() { reset(); }
+
+		template <typename Properties, typename Children>
+		const KeyIndex &get(const Properties &properties, const Children &children)
+		{
+			KeyIndex *built = index.load(std::memory_order_acquire);
+			if (built != nullptr)
+			{
+				// Keys inserted into the maps directly, without setValue or setChild
+				if (built->properties.size() != properties.size())
+					sortedKeys(properties, built->properties);
+				if (built->children.size() != children.size())
+					sortedKeys(children, built->children);
+				return *built;
+			}
+
+			auto fresh = std::make_unique<KeyIndex>();
+			sortedKeys(properties, fresh->properties);
+			sortedKeys(children, fresh->children);
+			KeyIndex *expected = nullptr;
+			if (index.compare_exchange_strong(expected, fresh.get(), std::memory_order_acq_rel, std::memory_order_acquire))
+				return *fresh.release();
+			return *expected;
+		}
+
+		/**
+		 * @brief Install an index built by the caller, e.g. sorted on a pool, see Node::setValues.
+		 */
+		void publish(std::unique_ptr<KeyIndex> built) { delete index.exchange(built.release(), std::memory_order_acq_rel); }
+
+		void reset()
+		{
+			if (index.load(std::memory_order_relaxed) != nullptr)
+				delete index.exchange(nullptr, std::memory_order_acq_rel);
+		}
+
+	private:
+		std::atomic<KeyIndex *> index{nullptr};
 	};
 
+#ifdef CWPARSER_PROFILE
+	/**
+	 * Access profiling, compiled in with -DCWPARSER_PROFILE only. See Profiler.
+	 */
+	inline void profileRecord(const Node *node, const Key &key, const std::type_info *type, uint64_t convert_ns);
+	inline void profileWatch(std::weak_ptr<const Node> root);
+
+	/**
+	 * @brief Counts one lookup when destroyed, with the time since converting() when it was called.
+	 */
+	class Probe
+	{
+	public:
+		Probe(const Node *node, const Key &key, const std::type_info *type) : node(node), key(key), type(type) {}
+		~Probe()
+		{
+			uint64_t elapsed = 0;
+			if (started)
+				elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now() - start).count());
+			profileRecord(node, key, type, elapsed);
+		}
+
+		void converting()
+		{
+			started = true;
+			start = std::chrono::steady_clock::now();
+		}
+
+	private:
+		const Node *node;
+		const Key &key;
+		const std::type_info *type;
+		bool started = false;
+		std::chrono::steady_clock::time_point start;
+	};
+
+	#define CWPARSER_PROBE(key, type) ::cwparser::_::Probe probe_(this, key, type)
+	#define CWPARSER_PROBE_CONVERT() probe_.converting()
+#else
+	#define CWPARSER_PROBE(key, type)
+	#define CWPARSER_PROBE_CONVERT()
+#endif
+
 	/**
-	 * Tools
+	 * @brief Property read but not stored yet, see Node::setValues.
 	 */
-	size_t inline countLeadingSpaces(const std::string &str)
+	struct Pending
 	{
-		auto it = str.find_first_not_of(" \t");
-		size_t ret = 0;
-		if(it == std::string::npos)
-			it = str.size();
-		for(int i = 0; i < it ; i++)
-		{
-			ret += str[i] == '\t'? 4 : 1;
-		}
-		return ret;
-	}
+		std::string key;
+		std::string value;
+		Location location;
+	};
 
-	std::string inline trim(const std::string &str)
+	/**
+	 * @brief Flag a copy does not inherit: the copy of a shared node belongs to one path only.
+	 */
+	struct ShareMark
 	{
-		const auto start = str.find_first_not_of(" \t");
-		if (start == std::string::npos)
-			return "";
-		const auto end = str.find_last_not_of(" \t");
-		return str.substr(start, end - start + 1);
-	}
+		bool set = false;
+
+		ShareMark() = default;
+		ShareMark(const ShareMark &) {}
+		ShareMark &operator=(const ShareMark &) { return *this; }
+	};
 
 } // namespace _
 
+class Selection;
+class Frozen;
+class Schema;
+struct SchemaError;
+class ThreadPool;
+
 #ifndef __cplusplus
 #elif __cplusplus > 201703L
 
@@ -198,57 +1511,336 @@ class Node
 	using optional = std::optional<T>;
 	#endif
 public:
-	std::map<std::string, std::string> properties;
-	std::map<std::string, std::shared_ptr<Node>> children;
+	std::map<Symbol, Value, _::KeyLess> properties;
+	std::map<Symbol, std::shared_ptr<Node>, _::KeyLess> children;
+	std::shared_ptr<_::TreeState> tree; // interner, references and lock, one per tree
 	static constexpr Node *end = nullptr;
 
+	explicit Node(std::shared_ptr<Interner> interner = Interner::global())
+		: tree(std::make_shared<_::TreeState>(_::TreeState{std::move(interner), nullptr, nullptr}))
+	{
+	}
+
+	/**
+	 * @brief Node of an existing tree, sharing its interner, references and lock.
+	 */
+	explicit Node(std::shared_ptr<_::TreeState> tree) : tree(std::move(tree)) {}
+
 	template <typename T>
-	optional<T> get(const std::string &key) const
+	optional<T> get(const Key &key) const
 	{
+		CWPARSER_PROBE(key, &typeid(T));
+		_::ReadGuard guard(tree->lock.get());
+		if (filter && !filter->mayContain(key.hash))
+			return optional<T>{};
 		auto it = properties.find(key);
 		if (it != properties.end())
 		{
-			return _::get_from_string<T>(it->second);
+			CWPARSER_PROBE_CONVERT();
+			T value{};
+			if (_::fromScalar(typed(it->second), value))
+				return value;
+			std::string_view text;
+			_::Status status = resolve(it->second, text);
+			if (status)
+				status = _::try_from_string(text, value);
+			if (!status)
+				_::throw_error(status.code, _::describe(it->first.view(), it->second.location, status));
+			return value;
 		}
 		return optional<T>{};
 	}
 
+	/**
+	 * @brief Non-throwing get, failures carry an ErrorCode and the line/column of the bad text.
+	 */
+	template <typename T>
+	Result<T> try_get(const Key &key) const
+	{
+		CWPARSER_PROBE(key, &typeid(T));
+		_::ReadGuard guard(tree->lock.get());
+		if (filter && !filter->mayContain(key.hash))
+			return Error{ErrorCode::missing_key};
+		auto it = properties.find(key);
+		if (it == properties.end())
+			return Error{ErrorCode::missing_key};
+
+		CWPARSER_PROBE_CONVERT();
+		T value{};
+		if (_::fromScalar(typed(it->second), value))
+			return value;
+		std::string_view text;
+		_::Status status = resolve(it->second, text);
+		if (status)
+			status = _::try_from_string(text, value);
+		if (!status)
+			return _::locate(it->second.location, status);
+		return value;
+	}
+
 	template <typename T>
 	std::unordered_map<std::string, T>
 	getAll()
 	{
+		_::ReadGuard guard(tree->lock.get());
 		if (properties.size() > 0)
 		{
-			std::string value;
 			std::unordered_map<std::string, T> result;
-			for (const auto it : properties)
+			for (const auto &it : properties)
 			{
 				const auto &key = it.first;
 				const auto &value = it.second;
 				if (value.empty())
 					continue;
-				result.emplace(key, _::get_from_string<T>(value));
+				std::string_view text;
+				_::Status status = resolve(value, text);
+				if (!status)
+					_::throw_error(status.code, _::describe(key.view(), value.location, status));
+				result.emplace(key, _::get_from_string<T>(text));
 			}
 			return result;
 		}
 		return std::unordered_map<std::string, T>{};
 	}
 
-	void setValue(const std::string &key, const std::string &value)
+	/**
+	 * @brief Add or replace a property. In concurrent mode readers are held off while it is stored,
+	 *        the returned reference is then only safe to use from the writing thread.
+	 */
+	Value &setValue(const Key &key, std::string value, Location location = {})
+	{
+		refuseShared();
+		_::WriteGuard guard(tree->lock.get());
+		// One descent finds the key or the place to insert it
+		auto it = properties.lower_bound(key);
+		if (it != properties.end() && it->first.hash() == key.hash && it->first.view() == key.text)
+		{
+			if (digested)
+				properties_digest -= _::propertyHash(key.hash, _::hash(it->second.text()));
+			// The new text is not converted, its slot is cleared and kept for when it is
+			uint32_t slot = it->second.slot;
+			it->second = Value{std::move(value), location};
+			if (slot != 0)
+			{
+				it->second.slot = slot;
+				(*scalars)[slot - 1] = Scalar{};
+			}
+		}
+		else
+		{
+			it = properties.emplace_hint(it, tree->interner->intern(key), Value{std::move(value), location});
+			index.reset();
+			if (filter)
+				filter->insert(key.hash);
+		}
+		if (digested)
+			properties_digest += _::propertyHash(key.hash, _::hash(it->second.text()));
+		if (tree->references)
+		{
+			if (it->second.interpolated)
+				tree->references->noteInterpolated();
+			tree->references->invalidate();
+		}
+		return it->second;
+	}
+
+	/**
+	 * @brief Store many properties at once, later entries win over earlier ones with the same key.
+	 *
+	 * Large batches going into a node without properties are interned and sorted on the pool, then
+	 * appended to the map in key order without searching it; the pool also sorts the names for
+	 * keyIndex(), which a first query would otherwise sort on one thread. Others are stored one by one.
+	 * With typed set each value is classified as it is stored, see cwparser::setEagerTyping.
+	 * Defined in bulk.hpp.
+	 */
+	void setValues(std::vector<_::Pending> &batch, ThreadPool &pool, bool typed = false, size_t min_parallel = 1 << 14);
+
+	/**
+	 * @brief Text of value with its ${section.key} references expanded, expanded once then memoized.
+	 *
+	 * Values without references are returned as is. Fails with missing_key when a reference does
+	 * not exist and with reference_cycle when it leads back to itself.
+	 */
+	_::Status resolve(const Value &value, std::string_view &text) const
+	{
+		if (!value.interpolated || !tree->references)
+		{
+			text = value.text();
+			return {};
+		}
+		return tree->references->resolve(value, text);
+	}
+
+	/**
+	 * @brief Attach or replace a child, the fingerprint follows the child's current one. A child built
+	 *        apart joins the references and the lock of this tree.
+	 */
+	void setChild(const Key &name, std::shared_ptr<Node> child)
+	{
+		refuseShared();
+		std::shared_ptr<_::TreeState> from, to;
+		child->adopt(tree, from, to);
+		_::WriteGuard guard(tree->lock.get());
+		auto it = children.find(name);
+		if (it != children.end())
+		{
+			if (digested)
+				children_digest -= _::childHash(name.hash, it->second->fingerprint());
+			// No reader is inside the lock, the old child lives on only in the hands of child() callers
+			it->second = std::move(child);
+		}
+		else
+		{
+			it = children.emplace(tree->interner->intern(name), std::move(child)).first;
+			index.reset();
+			if (filter)
+				filter->insert(name.hash);
+		}
+		if (digested)
+			children_digest += _::childHash(name.hash, it->second->fingerprint());
+		// Paths through the child now lead elsewhere, and the memo may hold values it freed
+		if (tree->references)
+			tree->references->invalidate();
+	}
+
+	/**
+	 * @brief Content hash of the node and everything below it, equal subtrees hash equal whatever their order.
+	 *
+	 * Computed on the first call, then setValue() and setChild() keep it current for the node they
+	 * touch. After editing a descendant in place call refreshFingerprint() on the ancestor before comparing.
+	 */
+	uint64_t fingerprint() const
+	{
+		if (!digested)
+		{
+			digestProperties();
+			children_digest = 0;
+			for (const auto &child : children)
+				children_digest += _::childHash(child.first.hash(), child.second->fingerprint());
+			digested = true;
+		}
+		return _::subtreeHash(properties_digest, children_digest);
+	}
+
+	uint64_t refreshFingerprint()
+	{
+		if (!digested)
+			digestProperties();
+		digested = true;
+		children_digest = 0;
+		for (const auto &child : children)
+			children_digest += _::childHash(child.first.hash(), child.second->refreshFingerprint());
+		return _::subtreeHash(properties_digest, children_digest);
+	}
+
+	/**
+	 * @brief Let get(), try_get() and operator[] turn most absent names away before searching the maps.
+	 *
+	 * setValue() and setChild() keep the filter current; call it again after inserting into the maps directly.
+	 */
+	void buildFilter()
+	{
+		_::KeyFilter &built = filter ? *filter : filter.emplace();
+		built.reset(properties.size() + children.size());
+		for (const auto &prop : properties)
+			built.insert(prop.first.hash());
+		for (const auto &child : children)
+			built.insert(child.first.hash());
+	}
+
+	/**
+	 * @brief False when name is certainly neither a property nor a child, always true without a filter.
+	 */
+	bool mayContain(const Key &name) const
+	{
+		_::ReadGuard guard(tree->lock.get());
+		return !filter || filter->mayContain(name.hash);
+	}
+
+	/**
+	 * @brief Names sorted lexicographically. Nothing is sorted while parsing: the first query walking
+	 *        the node builds it, and it is built again after keys were added.
+	 */
+	const _::KeyIndex &keyIndex() const { return index.get(properties, children); }
+
+	/**
+	 * @brief Lazily iterate the properties matching a dotted glob pattern, e.g. "sensors.*.rate".
+	 *        See Selection for the pattern syntax.
+	 */
+	Selection select(std::string_view pattern) const;
+
+	/**
+	 * @brief Make the node and everything below it read-only, deduplicate() does so for the sections it
+	 *        points several paths at. setValue() and setChild() then throw std::logic_error; copies, such
+	 *        as the ones with_value() makes along its path, are writable again.
+	 */
+	void share()
+	{
+		if (shared.set)
+			return;
+		shared.set = true;
+		for (auto &child : children)
+			child.second->share();
+	}
+	bool isShared() const { return shared.set; }
+
+	/**
+	 * @brief Converted form of value, a property of this node; kind none when it is only text.
+	 *
+	 * Slots only exist once eager typing or a schema converted a value of the node, other nodes carry
+	 * a null pointer for them. See cwparser::setEagerTyping.
+	 */
+	const Scalar &typed(const Value &value) const
+	{
+		static const Scalar none;
+		return value.slot != 0 ? (*scalars)[value.slot - 1] : none;
+	}
+
+	/**
+	 * @brief Writable slot of value, a property of this node, added when it has none. The caller
+	 *        holds the writer's side in concurrent mode, as setValue() does.
+	 */
+	Scalar &typedSlot(Value &value)
+	{
+		std::vector<Scalar> &slots = scalars ? *scalars : scalars.emplace();
+		if (value.slot == 0)
+		{
+			slots.emplace_back();
+			value.slot = static_cast<uint32_t>(slots.size());
+		}
+		return slots[value.slot - 1];
+	}
+
+	/**
+	 * @brief Shared ownership of a child, null when missing.
+	 *
+	 * In concurrent mode a section another thread may replace through setChild() is read this way: the
+	 * returned node outlives its replacement, while a reference from operator[] does not.
+	 */
+	std::shared_ptr<Node> child(const Key &name) const
 	{
-		properties[key] = value;
+		CWPARSER_PROBE(name, nullptr);
+		_::ReadGuard guard(tree->lock.get());
+		if (filter && !filter->mayContain(name.hash))
+			return nullptr;
+		auto it = children.find(name);
+		return it != children.end() ? it->second : nullptr;
 	}
 
 	// Add operator[] for chained access
-	Node &operator[](const std::string &name)
+	Node &operator[](const Key &name)
 	{
-		auto it = children.find(std::string(name));
+		CWPARSER_PROBE(name, nullptr);
+		_::ReadGuard guard(tree->lock.get());
+		if (filter && !filter->mayContain(name.hash))
+			return *end;
+		auto it = children.find(name);
 		return (it != children.end()) ? *it->second : *end;
 	}
-	// Overload for string literals
+	// Overload for string literals, avoids the built-in subscript through operator bool
 	inline Node &operator[](const char *name)
 	{
-		return operator[](std::string(name));
+		return operator[](Key(name));
 	}
 
 	// Add bool operator for null checking
@@ -256,103 +1848,372 @@ public:
 	{
 		return this != end;
 	}
+
+private:
+	void refuseShared() const
+	{
+		if (shared.set)
+			throw std::logic_error("section is shared by deduplicate(), edit it with with_value()");
+	}
+
+	// Nodes built apart join the references and the lock of the tree they are attached to and keep their
+	// interner. from and to remember the last state replaced, the nodes of a subtree usually share it
+	void adopt(const std::shared_ptr<_::TreeState> &parent, std::shared_ptr<_::TreeState> &from, std::shared_ptr<_::TreeState> &to)
+	{
+		if (tree != from)
+		{
+			from = tree;
+			to = tree;
+			if ((!tree->references && parent->references) || (!tree->lock && parent->lock))
+			{
+				to = std::make_shared<_::TreeState>(_::TreeState{tree->interner,
+					tree->references ? tree->references : parent->references, tree->lock ? tree->lock : parent->lock});
+				if (to->interner == parent->interner && to->references == parent->references && to->lock == parent->lock)
+					to = parent;
+			}
+		}
+		if (to != tree)
+		{
+			if (!tree->references && to->references)
+			{
+				for (const auto &prop : properties)
+				{
+					if (prop.second.interpolated)
+						to->references->noteInterpolated();
+				}
+			}
+			tree = to;
+		}
+		for (auto &child : children)
+			child.second->adopt(parent, from, to);
+	}
+
+	void digestProperties() const
+	{
+		properties_digest = 0;
+		for (const auto &prop : properties)
+			properties_digest += _::propertyHash(prop.first.hash(), _::hash(prop.second.text()));
+	}
+
+	mutable _::LazyIndex index;
+	_::Boxed<_::KeyFilter> filter;
+	_::Boxed<std::vector<Scalar>> scalars;
+	mutable uint64_t properties_digest = 0;
+	mutable uint64_t children_digest = 0;
+	mutable bool digested = false;
+	_::ShareMark shared;
+};
+
+/**
+ * @brief Callbacks for cwparser::scan. Derive and redeclare the ones you need, calls are resolved statically.
+ *        Returning true from stop() ends the scan before the next line.
+ */
+struct Handler
+{
+	void on_section_begin(std::string_view /*name*/, size_t /*depth*/) {}
+	void on_property(std::string_view /*key*/, std::string_view /*value*/, Location /*location*/) {}
+	void on_section_end(std::string_view /*name*/, size_t /*depth*/) {}
+	bool stop() const { return false; }
 };
 
 class cwparser
 {
 public:
-	cwparser() = default;
+	cwparser() : cwparser(std::make_shared<Interner>()) {}
+
+	/**
+	 * @brief Build nodes with a caller supplied interner, e.g. one shared by several parsers.
+	 */
+	explicit cwparser(std::shared_ptr<Interner> interner)
+		: interner(std::move(interner)), root(std::make_shared<Node>(this->interner))
+	{
+	}
 
 	bool parse(const std::string &filename)
 	{
-		nodes.clear();
-		std::ifstream file(filename);
+		root = std::make_shared<Node>(interner);
+		std::ifstream file(filename, std::ios::binary);
 		if (!file.is_open())
 		{
 			std::cerr << "Failed to open file: " << filename << std::endl;
 			return false;
 		}
+		return parse(file);
+	}
 
-		std::string line;
-		std::vector<std::pair<std::string, std::shared_ptr<Node>>> nodeStack;
-		auto current_node = std::make_shared<Node>();
-		nodes[""] = current_node;
+	/**
+	 * @brief Parse configuration text from a stream, replacing the current tree.
+	 */
+	bool parse(std::istream &in)
+	{
+		root = std::make_shared<Node>(interner);
+		TreeBuilder builder{*interner, root, {}, root, eager_typing};
+		return build(in, builder);
+	}
 
-		while (std::getline(file, line))
+	/**
+	 * @brief Parse and validate against schema in the same pass, stopping at the first violation.
+	 *
+	 * Declared numbers and booleans are converted once while reading, get() then returns them without
+	 * parsing the text again. On failure error, when given, receives the code and location of the bad
+	 * value; a missing required key has no location but the section path and the key name instead.
+	 * The tree then holds what was read up to that point. Defined in schema.hpp.
+	 */
+	bool parse(const std::string &filename, const Schema &schema, SchemaError *error = nullptr)
+	{
+		root = std::make_shared<Node>(interner);
+		std::ifstream file(filename, std::ios::binary);
+		if (!file.is_open())
 		{
+			std::cerr << "Failed to open file: " << filename << std::endl;
+			return false;
+		}
+		return parse(file, schema, error);
+	}
 
-			// Count leading spaces to determine level
-			size_t indent = _::countLeadingSpaces(line);
-			line = _::trim(line);
-
-			if (line.empty() || line[0] == '#')
-				continue;
-
-			// Parse key-value pairs
-			size_t delimiter = line.find(':');
-			if (delimiter != std::string::npos && !nodeStack.empty())
-			{
-				std::string key =
-					_::trim(line.substr(0, delimiter));
-				std::string value =
-					_::trim(line.substr(delimiter + 1));
-				parseValue(*current_node, key, value);
-				continue;
-			}
-			// Pop stack until we're at the right level
-			while (!nodeStack.empty() && nodeStack.size() > (indent / 4))
-			{
-				nodeStack.pop_back();
-			}
+	bool parse(std::istream &in, const Schema &schema, SchemaError *error = nullptr);
 
-			// Check for node header [nodeX]
-			if (line[0] == '[' && line.back() == ']')
-			{
-				std::string nodeName = line.substr(1, line.length() - 2);
-				auto newNode = std::make_shared<Node>();
+	/**
+	 * @brief Parse with the help of pool, for sections holding a very large number of keys.
+	 *
+	 * The properties of a section are gathered until its end and stored with Node::setValues.
+	 * The tree is the same as with parse(filename). Defined in bulk.hpp.
+	 */
+	bool parse(const std::string &filename, ThreadPool &pool)
+	{
+		root = std::make_shared<Node>(interner);
+		std::ifstream file(filename, std::ios::binary);
+		if (!file.is_open())
+		{
+			std::cerr << "Failed to open file: " << filename << std::endl;
+			return false;
+		}
+		return parse(file, pool);
+	}
 
-				if (nodeStack.empty())
-				{
-					// Root level node
-					nodes[nodeName] = newNode;
-					current_node = newNode;
-				}
-				else
-				{
-					// Child node
-					nodeStack.back().second->children[nodeName] = newNode;
-					current_node = newNode;
-				}
+	bool parse(std::istream &in, ThreadPool &pool);
 
-				nodeStack.push_back({nodeName, current_node});
-				continue;
-			}
+	/**
+	 * @brief Stream the file through handler callbacks without building a tree.
+	 *
+	 * Memory stays bounded by the read window and the longest line, for files of any size.
+	 * The views handed to the callbacks are only valid during the call. See Handler.
+	 */
+	template <typename H>
+	static bool scan(const std::string &filename, H &handler, size_t window = 1 << 16)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		if (!file.is_open())
+		{
+			std::cerr << "Failed to open file: " << filename << std::endl;
+			return false;
 		}
-
-		return true;
+		return scan(file, handler, window);
 	}
 
-	Node &operator[](const std::string &nodePath)
+	template <typename H>
+	static bool scan(std::istream &in, H &handler, size_t window = 1 << 16)
 	{
-		auto it = nodes.find(nodePath);
-		if (it == nodes.end())
-			return *Node::end;
-		return *(it->second.get());
+		_::LineReader reader(in, window);
+		_::tokenize(reader, handler);
+		return !in.bad();
 	}
 
-	// Overload for string literals
-	Node &operator[](const char *nodeName)
+	Node &operator[](const Key &nodePath)
 	{
-		return operator[](std::string(nodeName));
+		return (*root)[nodePath];
 	}
 
+	/**
+	 * @brief Unnamed node holding the top level sections as children.
+	 */
+	Node &getRoot() { return *root; }
+	const Node &getRoot() const { return *root; }
+
+	Selection select(std::string_view pattern) const;
+
+	/**
+	 * @brief Pack the tree into one contiguous immutable block for faster, thread-safe lookups.
+	 *        The result is independent from the parser, which may be destroyed afterwards.
+	 */
+	Frozen freeze() const;
+
+	/**
+	 * @brief Copy of the configuration with one value changed, e.g. with_value("network.server.port", "9090").
+	 *
+	 * This parser is left as is. The result copies only the sections on the path to the key and shares
+	 * every other subtree with this one, so keeping many versions around is cheap. Nodes reachable from
+	 * several versions are shared: edit versions through with_value(), not setValue(), to keep them apart.
+	 */
+	cwparser with_value(std::string_view path, std::string value) const;
+
+	/**
+	 * @brief Apply many (path, value) updates in one pass, sections crossed by several are copied once.
+	 */
+	cwparser with_values(const std::vector<std::pair<std::string, std::string>> &updates) const;
+
+	/**
+	 * @brief Share one copy between sections whose whole content is identical, e.g. repeated device defaults.
+	 *
+	 * Lookups are unchanged, each sharing section reports the locations of the first copy read. A shared
+	 * node belongs to every path leading to it, so it becomes read-only (see Node::share): edit with
+	 * with_value() afterwards. Value texts longer than the small string buffer are shared through the
+	 * interner as well, in every section, identical or not.
+	 * @return number of sections replaced by an identical one
+	 */
+	size_t deduplicate();
+
+	const std::shared_ptr<Interner> &getInterner() const { return interner; }
+
+	/**
+	 * @brief Classify every value while parsing, off by default.
+	 *
+	 * Integers (decimal or 0x hexadecimal), floating point numbers and booleans are converted once
+	 * into the typed slots of their node, get<int>() or get<double>() then check the kind and load the
+	 * number. Quoted strings, tuples and arrays are only tagged. Values with ${...} references are left
+	 * as text. With it off no slot is allocated, see Node::typed.
+	 */
+	void setEagerTyping(bool enabled) { eager_typing = enabled; }
+	bool getEagerTyping() const { return eager_typing; }
+
+	/**
+	 * @brief Give every parsed node a Bloom filter of its names, off by default, see Node::buildFilter.
+	 *
+	 * Meant for code probing many optional keys that are usually missing: most misses then cost a
+	 * hash mix and one word load instead of a search through the map. About two bytes per name.
+	 */
+	void setKeyFilter(bool enabled) { key_filter = enabled; }
+	bool getKeyFilter() const { return key_filter; }
+
+	/**
+	 * @brief Let worker threads read the parsed tree while another thread edits it, off by default.
+	 *
+	 * Node::get, try_get, getAll, operator[], child and mayContain may then run on any number of threads
+	 * alongside setValue and setChild. Readers share a read-mostly lock that costs one uncontended atomic
+	 * increment while nobody writes; a write waits for the readers in flight and holds new ones off
+	 * until it is stored. A child replaced by setChild is released at once, so threads reading a section
+	 * that may be swapped hold it through Node::child() rather than operator[]. Walks over the whole tree (freeze, select, diff, iterating the maps) are not
+	 * covered, run them from the writing thread.
+	 */
+	void setConcurrent(bool enabled) { concurrent = enabled; }
+	bool getConcurrent() const { return concurrent; }
+
 private:
-	std::map<std::string, std::shared_ptr<Node>> nodes;
+	std::shared_ptr<Interner> interner;
+	std::shared_ptr<Node> root;
+	bool eager_typing = false;
+	bool key_filter = false;
+	bool concurrent = false;
+
+	cwparser(std::shared_ptr<Interner> interner, std::shared_ptr<Node> root)
+		: interner(std::move(interner)), root(std::move(root))
+	{
+	}
+
+	struct SchemaBuilder;
+	struct BatchBuilder;
+
+	template <typename Builder>
+	bool build(std::istream &in, Builder &builder)
+	{
+		// Every node of the tree shares the root's state: values note their references as they are stored
+		root->tree->references = std::make_shared<_::References>(root);
+		_::LineReader reader(in);
+		_::tokenize(reader, builder);
+#ifdef CWPARSER_PROFILE
+		_::profileWatch(root);
+#endif
 
-	void
-	parseValue(Node &node, const std::string &key, const std::string &value)
+		if (concurrent)
+			root->tree->lock = std::make_shared<_::TreeLock>();
+		if (key_filter)
+			buildFilters(*root);
+		return !in.bad();
+	}
+
+	struct TreeBuilder
+	{
+		Interner &interner;
+		std::shared_ptr<Node> root;
+		std::vector<std::shared_ptr<Node>> stack;
+		std::shared_ptr<Node> current;
+		bool typed = false;
+
+		void on_section_begin(std::string_view name, size_t depth)
+		{
+			stack.resize(depth);
+			auto node = std::make_shared<Node>(root->tree);
+			// Root level nodes hang from the root, others from the enclosing node
+			Node &parent = stack.empty() ? *root : *stack.back();
+			parent.children[interner.intern(name)] = node;
+			current = node;
+			stack.push_back(std::move(node));
+		}
+
+		void on_property(std::string_view key, std::string_view value, Location location)
+		{
+			Value &stored = current->setValue(key, std::string(value), location);
+			if (typed && !stored.interpolated)
+				classify(*current, stored);
+		}
+
+		static void classify(Node &node, Value &value)
+		{
+			Scalar scalar;
+			_::classify(value.text(), scalar);
+			if (scalar.kind != Scalar::Kind::none || value.slot != 0)
+				node.typedSlot(value) = scalar;
+		}
+
+		void on_section_end(std::string_view, size_t) {}
+	};
+
+	static void buildFilters(Node &node)
 	{
-		node.setValue(key, value);
+		node.buildFilter();
+		for (const auto &child : node.children)
+			buildFilters(*child.second);
 	}
 };
-} // namespace cwparser
\ No newline at end of file
+} // namespace cwparser
+
+#include "query.hpp"
+#include "frozen.hpp"
+#include "persistent.hpp"
+#include "references.hpp"
+#include "dedup.hpp"
+#ifdef CWPARSER_PROFILE
+#include "profile.hpp"
+#endif
+
+// bulk.hpp, diff.hpp, loader.hpp, schema.hpp, profile.hpp and shared.hpp are included where used
+
+namespace cwparser
+{
+
+inline Selection Node::select(std::string_view pattern) const
+{
+	return Selection(*this, pattern);
+}
+
+inline Selection cwparser::select(std::string_view pattern) const
+{
+	return Selection(*root, pattern);
+}
+
+inline Frozen cwparser::freeze() const
+{
+	return Frozen::build(*root);
+}
+
+inline cwparser cwparser::with_value(std::string_view path, std::string value) const
+{
+	return with_values({{std::string(path), std::move(value)}});
+}
+
+inline cwparser cwparser::with_values(const std::vector<std::pair<std::string, std::string>> &updates) const
+{
+	return cwparser(interner, withValues(root, updates));
+}
+
+} // namespace cwparser
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace cwparser
+{
+namespace _
+{
+
+	/**
+	 * @brief Same keys, texts and children, the children being already shared when equal.
+	 */
+	inline bool sameContent(const Node &a, const Node &b)
+	{
+		if (a.properties.size() != b.properties.size() || a.children.size() != b.children.size())
+			return false;
+		// Both maps are ordered by (hash, text), equal key sets walk in step
+		for (auto x = a.properties.begin(), y = b.properties.begin(); x != a.properties.end(); ++x, ++y)
+		{
+			if (x->first.view() != y->first.view() || x->second.text() != y->second.text() ||
+				a.typed(x->second).kind != b.typed(y->second).kind)
+				return false;
+		}
+		for (auto x = a.children.begin(), y = b.children.begin(); x != a.children.end(); ++x, ++y)
+		{
+			if (x->first.view() != y->first.view() || x->second != y->second)
+				return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Bottom-up hash-consing: once its children are canonical a node is swapped for the first
+	 *        node seen with the same fingerprint and content.
+	 */
+	inline size_t shareSubtrees(std::shared_ptr<Node> &node, std::unordered_multimap<uint64_t, std::shared_ptr<Node>> &seen)
+	{
+		size_t shared = 0;
+		for (auto &child : node->children)
+			shared += shareSubtrees(child.second, seen);
+
+		auto range = seen.equal_range(node->fingerprint());
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second != node && sameContent(*it->second, *node))
+			{
+				it->second->share();
+				node = it->second;
+				return shared + 1;
+			}
+		}
+		seen.emplace(node->fingerprint(), node);
+		return shared;
+	}
+
+	/**
+	 * @brief Hand the texts too long for the small string buffer to the interner, one copy per text.
+	 */
+	inline void shareTexts(Node &node, Interner &interner)
+	{
+		static const size_t inline_capacity = std::string().capacity();
+		for (auto &property : node.properties)
+		{
+			if (property.second.text().size() > inline_capacity)
+				property.second.shareText(interner);
+		}
+		for (auto &child : node.children)
+			shareTexts(*child.second, interner);
+	}
+
+} // namespace _
+
+inline size_t cwparser::deduplicate()
+{
+	// Texts first, while every node is still reached once, the fingerprints do not change
+	_::shareTexts(*root, *root->tree->interner);
+	root->refreshFingerprint();
+	std::unordered_multimap<uint64_t, std::shared_ptr<Node>> seen;
+	size_t shared = 0;
+	for (auto &section : root->children)
+		shared += _::shareSubtrees(section.second, seen);
+	// The replaced sections took their values with them
+	if (shared > 0 && root->tree->references)
+		root->tree->references->invalidate();
+	return shared;
+}
+
+} // namespace cwparser
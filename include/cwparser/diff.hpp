@@ -0,0 +1,132 @@
+#pragma once
+
+// Include it explicitly: changes between two trees.
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cwparser.hpp"
+
+namespace cwparser
+{
+
+struct Change
+{
+	enum class Kind
+	{
+		added,
+		removed,
+		changed
+	};
+
+	Kind kind;
+	std::string path;
+};
+
+namespace _
+{
+
+	inline std::string joinPath(const std::string &prefix, const Symbol &name)
+	{
+		return prefix.empty() ? name.str() : prefix + "." + name.str();
+	}
+
+	/**
+	 * @brief Merge walk of two maps ordered by KeyLess, calls the visitor with either side null when missing.
+	 */
+	template <typename Map, typename Visitor>
+	void mergeWalk(const Map &before, const Map &after, Visitor &&visit)
+	{
+		KeyLess less;
+		auto a = before.begin(), b = after.begin();
+		while (a != before.end() || b != after.end())
+		{
+			if (b == after.end() || (a != before.end() && less(a->first, b->first)))
+			{
+				visit(a->first, &a->second, nullptr);
+				++a;
+			}
+			else if (a == before.end() || less(b->first, a->first))
+			{
+				visit(b->first, nullptr, &b->second);
+				++b;
+			}
+			else
+			{
+				visit(a->first, &a->second, &b->second);
+				++a;
+				++b;
+			}
+		}
+	}
+
+	inline bool interpolating(const Node &node) { return node.tree->references && node.tree->references->interpolating(); }
+
+	/**
+	 * @brief Whether a value reads differently, comparing expansions when either side holds a reference.
+	 */
+	inline bool changedValue(const Node &before, const Value &a, const Node &after, const Value &b)
+	{
+		if (!a.interpolated && !b.interpolated)
+			return a.text() != b.text();
+		std::string_view ta, tb;
+		Status sa = before.resolve(a, ta);
+		std::string resolved(ta);
+		Status sb = after.resolve(b, tb);
+		return sa.code != sb.code || resolved != tb;
+	}
+
+	inline void diffNodes(const Node &before, const Node &after, const std::string &prefix, std::vector<Change> &out)
+	{
+		if (&before == &after)
+			return;
+		// Equal text still reads differently when the referenced values changed
+		if (before.fingerprint() == after.fingerprint() && !interpolating(before) && !interpolating(after))
+			return;
+
+		mergeWalk(before.properties, after.properties, [&](const Symbol &key, const Value *a, const Value *b) {
+			if (a == nullptr)
+				out.push_back({Change::Kind::added, joinPath(prefix, key)});
+			else if (b == nullptr)
+				out.push_back({Change::Kind::removed, joinPath(prefix, key)});
+			else if (changedValue(before, *a, after, *b))
+				out.push_back({Change::Kind::changed, joinPath(prefix, key)});
+		});
+
+		mergeWalk(before.children, after.children,
+			[&](const Symbol &name, const std::shared_ptr<Node> *a, const std::shared_ptr<Node> *b) {
+				if (a == nullptr)
+					out.push_back({Change::Kind::added, joinPath(prefix, name)});
+				else if (b == nullptr)
+					out.push_back({Change::Kind::removed, joinPath(prefix, name)});
+				else
+					diffNodes(**a, **b, joinPath(prefix, name), out);
+			});
+	}
+
+} // namespace _
+
+/**
+ * @brief Paths that differ between two trees, sorted by path.
+ *
+ * Subtrees with equal fingerprints are skipped without being visited, so the cost follows the size of
+ * the change. Trees using ${...} references compare expanded values and are walked in full, a key
+ * is reported when its reference target changed. A section present on one side only is reported
+ * once, not per property.
+ */
+inline std::vector<Change> diff(const Node &before, const Node &after)
+{
+	std::vector<Change> changes;
+	_::diffNodes(before, after, {}, changes);
+	std::sort(changes.begin(), changes.end(), [](const Change &a, const Change &b) { return a.path < b.path; });
+	return changes;
+}
+
+inline std::vector<Change> diff(const cwparser &before, const cwparser &after)
+{
+	return diff(before.getRoot(), after.getRoot());
+}
+
+} // namespace cwparser
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cwparser
+{
+namespace _
+{
+
+	/**
+	 * Frozen block layout, offsets only so the block can be copied or mapped anywhere:
+	 *   FrozenHeader | FrozenNodeRecord[node_count] | FrozenPropertyRecord[property_count] | strings
+	 * Node 0 is the root. The children of a node, and its properties, are contiguous and sorted
+	 * by (hash, text) like the Node maps, lookups binary search on the hash.
+	 */
+	struct FrozenHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t node_count;
+		uint64_t property_count;
+		uint64_t total_bytes;
+		uint64_t nodes_offset;
+		uint64_t properties_offset;
+		uint64_t strings_offset;
+	};
+
+	struct FrozenNodeRecord
+	{
+		uint64_t name_hash;
+		uint64_t name_offset;
+		uint32_t name_length;
+		uint32_t first_child;
+		uint32_t child_count;
+		uint32_t property_count;
+		uint64_t first_property;
+		uint64_t subtree_bytes;
+	};
+
+	struct FrozenPropertyRecord
+	{
+		uint64_t key_hash;
+		uint64_t key_offset;
+		uint64_t value_offset;
+		uint32_t key_length;
+		uint32_t value_length;
+		uint32_t line;
+		uint32_t column;
+	};
+
+	constexpr char frozen_magic[8] = {'c', 'w', 'p', 'f', 'r', 'z', 'n', '\0'};
+	constexpr uint32_t frozen_version = 1;
+
+	template <typename Record>
+	const Record *frozenFind(const Record *first, size_t count, const Key &key, uint64_t Record::*hash,
+							 std::string_view (*text)(const char *, const Record &), const char *base)
+	{
+		const Record *last = first + count;
+		const Record *it = std::lower_bound(first, last, key.hash,
+			[hash](const Record &record, uint64_t value) { return record.*hash < value; });
+		for (; it != last && it->*hash == key.hash; ++it)
+		{
+			if (text(base, *it) == key.text)
+				return it;
+		}
+		return nullptr;
+	}
+
+} // namespace _
+
+/**
+ * @brief Read-only view of a node inside a frozen block, cheap to copy.
+ *
+ * Lookups never allocate or modify anything, so any number of threads may use the same block.
+ */
+class FrozenNode
+{
+	#ifndef __cplusplus
+	#elif __cplusplus > 201703L
+	template<typename T>
+	using optional = std::optional<T>;
+	#endif
+public:
+	FrozenNode() = default;
+	FrozenNode(const char *base, uint32_t index) : base(base), index(index) {}
+
+	template <typename T>
+	optional<T> get(const Key &key) const
+	{
+		const _::FrozenPropertyRecord *prop = find(key);
+		if (prop != nullptr)
+		{
+			T value{};
+			_::Status status = _::try_from_string(text(prop), value);
+			if (!status)
+				_::throw_error(status.code, _::describe(key.text, {prop->line, prop->column}, status));
+			return value;
+		}
+		return optional<T>{};
+	}
+
+	template <typename T>
+	Result<T> try_get(const Key &key) const
+	{
+		const _::FrozenPropertyRecord *prop = find(key);
+		if (prop == nullptr)
+			return Error{ErrorCode::missing_key};
+
+		T value{};
+		_::Status status = _::try_from_string(text(prop), value);
+		if (!status)
+			return _::locate({prop->line, prop->column}, status);
+		return value;
+	}
+
+	/**
+	 * @brief Raw text of a property, empty view when missing.
+	 */
+	std::string_view raw(const Key &key) const
+	{
+		const _::FrozenPropertyRecord *prop = find(key);
+		return prop != nullptr ? text(prop) : std::string_view{};
+	}
+
+	FrozenNode operator[](const Key &name) const
+	{
+		if (base == nullptr)
+			return {};
+		const _::FrozenNodeRecord &rec = record();
+		const _::FrozenNodeRecord *child = _::frozenFind(nodes() + rec.first_child, rec.child_count, name,
+			&_::FrozenNodeRecord::name_hash, &nameText, base);
+		return child != nullptr ? FrozenNode(base, static_cast<uint32_t>(child - nodes())) : FrozenNode();
+	}
+
+	explicit operator bool() const { return base != nullptr; }
+
+	std::string_view name() const { return nameText(base, record()); }
+	size_t childCount() const { return record().child_count; }
+	size_t propertyCount() const { return record().property_count; }
+
+	/**
+	 * @brief Bytes of the block used by this node and everything below it.
+	 *        Key and section names shared through interning are counted once per use.
+	 */
+	size_t bytes() const { return base != nullptr ? record().subtree_bytes : 0; }
+
+private:
+	const char *base = nullptr;
+	uint32_t index = 0;
+
+	const _::FrozenHeader &header() const { return *reinterpret_cast<const _::FrozenHeader *>(base); }
+	const _::FrozenNodeRecord *nodes() const { return reinterpret_cast<const _::FrozenNodeRecord *>(base + header().nodes_offset); }
+	const _::FrozenPropertyRecord *properties() const { return reinterpret_cast<const _::FrozenPropertyRecord *>(base + header().properties_offset); }
+	const _::FrozenNodeRecord &record() const { return nodes()[index]; }
+
+	static std::string_view nameText(const char *base, const _::FrozenNodeRecord &rec)
+	{
+		const auto &head = *reinterpret_cast<const _::FrozenHeader *>(base);
+		return {base + head.strings_offset + rec.name_offset, rec.name_length};
+	}
+
+	static std::string_view keyText(const char *base, const _::FrozenPropertyRecord &rec)
+	{
+		const auto &head = *reinterpret_cast<const _::FrozenHeader *>(base);
+		return {base + head.strings_offset + rec.key_offset, rec.key_length};
+	}
+
+	std::string_view text(const _::FrozenPropertyRecord *prop) const
+	{
+		return {base + header().strings_offset + prop->value_offset, prop->value_length};
+	}
+
+	const _::FrozenPropertyRecord *find(const Key &key) const
+	{
+		if (base == nullptr)
+			return nullptr;
+		const _::FrozenNodeRecord &rec = record();
+		return _::frozenFind(properties() + rec.first_property, rec.property_count, key,
+			&_::FrozenPropertyRecord::key_hash, &keyText, base);
+	}
+};
+
+/**
+ * @brief Immutable copy of a parsed tree packed in one contiguous block, see cwparser::freeze().
+ *
+ * Copies share the block, which lives until the last copy is gone.
+ */
+class Frozen
+{
+public:
+	Frozen() = default;
+
+	/**
+	 * @brief Wrap an existing frozen block, storage keeps the memory alive.
+	 */
+	Frozen(std::shared_ptr<const void> storage, const char *base) : storage(std::move(storage)), base(base) {}
+
+	static Frozen build(const Node &root)
+	{
+		std::vector<const Node *> order{&root};
+		std::vector<Symbol> names{Symbol()};
+		std::vector<uint32_t> parents{0};
+		std::vector<uint32_t> first_child;
+		uint64_t property_count = 0;
+		for (size_t idx = 0; idx < order.size(); idx++)
+		{
+			first_child.push_back(static_cast<uint32_t>(order.size()));
+			property_count += order[idx]->properties.size();
+			for (const auto &child : order[idx]->children)
+			{
+				order.push_back(child.second.get());
+				names.push_back(child.first);
+				parents.push_back(static_cast<uint32_t>(idx));
+			}
+		}
+
+		// Names are interned, store each distinct one once
+		std::unordered_map<const std::string *, uint64_t> name_offsets;
+		std::string strings;
+		auto addName = [&](const Symbol &name) -> uint64_t {
+			if (!name)
+				return 0;
+			auto it = name_offsets.find(&name.str());
+			if (it != name_offsets.end())
+				return it->second;
+			uint64_t offset = strings.size();
+			strings.append(name.view());
+			name_offsets.emplace(&name.str(), offset);
+			return offset;
+		};
+
+		// Values repeated across the tree, e.g. in sections shared by deduplicate(), are stored once too
+		std::unordered_map<std::string_view, uint64_t> value_offsets;
+		auto addValue = [&](std::string_view text) -> uint64_t {
+			auto it = value_offsets.find(text);
+			if (it != value_offsets.end())
+				return it->second;
+			uint64_t offset = strings.size();
+			strings.append(text);
+			value_offsets.emplace(text, offset);
+			return offset;
+		};
+
+		std::vector<_::FrozenNodeRecord> node_records(order.size());
+		std::vector<_::FrozenPropertyRecord> property_records;
+		property_records.reserve(property_count);
+		for (size_t idx = 0; idx < order.size(); idx++)
+		{
+			const Node &node = *order[idx];
+			_::FrozenNodeRecord &rec = node_records[idx];
+			rec.name_hash = names[idx] ? names[idx].hash() : 0;
+			rec.name_offset = addName(names[idx]);
+			rec.name_length = names[idx] ? static_cast<uint32_t>(names[idx].view().size()) : 0;
+			rec.first_child = first_child[idx];
+			rec.child_count = static_cast<uint32_t>(node.children.size());
+			rec.first_property = property_records.size();
+			rec.property_count = static_cast<uint32_t>(node.properties.size());
+			rec.subtree_bytes = sizeof(_::FrozenNodeRecord) + rec.name_length;
+			for (const auto &prop : node.properties)
+			{
+				// References are stored expanded, values that fail to resolve are kept as written
+				std::string_view text;
+				if (!node.resolve(prop.second, text))
+					text = prop.second.text();
+
+				_::FrozenPropertyRecord p{};
+				p.key_hash = prop.first.hash();
+				p.key_offset = addName(prop.first);
+				p.key_length = static_cast<uint32_t>(prop.first.view().size());
+				p.value_offset = addValue(text);
+				p.value_length = static_cast<uint32_t>(text.size());
+				p.line = prop.second.location.line;
+				p.column = prop.second.location.column;
+				property_records.push_back(p);
+				rec.subtree_bytes += sizeof(_::FrozenPropertyRecord) + p.key_length + p.value_length;
+			}
+		}
+		// Children always come after their parent, accumulate bottom up
+		for (size_t idx = order.size(); idx-- > 1;)
+			node_records[parents[idx]].subtree_bytes += node_records[idx].subtree_bytes;
+
+		_::FrozenHeader header{};
+		std::memcpy(header.magic, _::frozen_magic, sizeof(header.magic));
+		header.version = _::frozen_version;
+		header.node_count = static_cast<uint32_t>(order.size());
+		header.property_count = property_records.size();
+		header.nodes_offset = sizeof(_::FrozenHeader);
+		header.properties_offset = header.nodes_offset + node_records.size() * sizeof(_::FrozenNodeRecord);
+		header.strings_offset = header.properties_offset + property_records.size() * sizeof(_::FrozenPropertyRecord);
+		header.total_bytes = header.strings_offset + strings.size();
+
+		std::shared_ptr<uint64_t> block(new uint64_t[(header.total_bytes + 7) / 8], std::default_delete<uint64_t[]>());
+		char *base = reinterpret_cast<char *>(block.get());
+		std::memcpy(base, &header, sizeof(header));
+		std::memcpy(base + header.nodes_offset, node_records.data(), node_records.size() * sizeof(_::FrozenNodeRecord));
+		std::memcpy(base + header.properties_offset, property_records.data(), property_records.size() * sizeof(_::FrozenPropertyRecord));
+		std::memcpy(base + header.strings_offset, strings.data(), strings.size());
+		return Frozen(std::move(block), base);
+	}
+
+	FrozenNode root() const { return base != nullptr ? FrozenNode(base, 0) : FrozenNode(); }
+	FrozenNode operator[](const Key &nodePath) const { return root()[nodePath]; }
+
+	explicit operator bool() const { return base != nullptr; }
+
+	/**
+	 * @brief Size of the whole block, header included.
+	 */
+	size_t bytes() const { return base != nullptr ? reinterpret_cast<const _::FrozenHeader *>(base)->total_bytes : 0; }
+
+	const char *data() const { return base; }
+
+private:
+	std::shared_ptr<const void> storage;
+	const char *base = nullptr;
+};
+
+} // namespace cwparser
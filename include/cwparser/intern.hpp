@@ -0,0 +1,242 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cwparser
+{
+namespace _
+{
+
+	/**
+	 * @brief FNV-1a, used for every key/section name hash in the library.
+	 */
+	constexpr uint64_t hash(std::string_view str)
+	{
+		uint64_t h = 14695981039346656037ull;
+		for (char c : str)
+		{
+			h ^= static_cast<unsigned char>(c);
+			h *= 1099511628211ull;
+		}
+		return h;
+	}
+
+	/**
+	 * @brief splitmix64 finalizer, spreads hashes before they are summed into node fingerprints.
+	 */
+	constexpr uint64_t mix(uint64_t h)
+	{
+		h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+		h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+		return h ^ (h >> 31);
+	}
+
+	struct InternEntry
+	{
+		std::string text;
+		uint64_t hash = 0;
+	};
+
+} // namespace _
+
+/**
+ * @brief Handle to an interned string. Equal names from the same Interner share one entry,
+ *        so equality is a pointer comparison. Valid while its Interner is alive.
+ */
+class Symbol
+{
+public:
+	Symbol() = default;
+	explicit Symbol(const _::InternEntry *entry) : entry_(entry) {}
+
+	const std::string &str() const { return entry_->text; }
+	std::string_view view() const { return entry_->text; }
+	uint64_t hash() const { return entry_->hash; }
+
+	operator const std::string &() const { return entry_->text; }
+	explicit operator bool() const { return entry_ != nullptr; }
+
+	bool operator==(const Symbol &other) const { return entry_ == other.entry_; }
+	bool operator!=(const Symbol &other) const { return entry_ != other.entry_; }
+
+private:
+	const _::InternEntry *entry_ = nullptr;
+};
+
+/**
+ * @brief Lookup key carrying its precomputed hash.
+ *
+ * Declared constexpr the hash is computed at compile time:
+ * @code constexpr cwparser::Key port{"port"}; node.get<int>(port); @endcode
+ * Built from a string at runtime it hashes once and never allocates.
+ */
+struct Key
+{
+	std::string_view text;
+	uint64_t hash;
+
+	constexpr Key(std::string_view text) : text(text), hash(_::hash(text)) {}
+	constexpr Key(const char *text) : Key(std::string_view(text)) {}
+	Key(const std::string &text) : Key(std::string_view(text)) {}
+	Key(const Symbol &symbol) : text(symbol.view()), hash(symbol.hash()) {}
+};
+
+/**
+ * @brief Stores every distinct key and section name once.
+ *
+ * Each parser owns one by default; pass the same instance to several parsers to share it.
+ * Interning is thread-safe, the table is split in shards to keep lock contention low. A shard is an
+ * open addressed table of entry pointers, the entries themselves are carved from blocks that are
+ * never moved nor freed before the interner.
+ */
+class Interner
+{
+public:
+	Interner() = default;
+	Interner(const Interner &) = delete;
+	Interner &operator=(const Interner &) = delete;
+
+	Symbol intern(const Key &key)
+	{
+		Shard &shard = shards[key.hash % shards.size()];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		if ((shard.count + 1) * 2 > shard.slots.size())
+			shard.grow();
+		const _::InternEntry *&slot = shard.probe(key);
+		if (slot != nullptr)
+			return Symbol(slot);
+		return Symbol(shard.insert(key, slot));
+	}
+
+	/**
+	 * @brief Returns an empty Symbol when the text was never interned.
+	 */
+	Symbol find(const Key &key)
+	{
+		Shard &shard = shards[key.hash % shards.size()];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		return Symbol(shard.slots.empty() ? nullptr : shard.probe(key));
+	}
+
+	size_t size()
+	{
+		size_t ret = 0;
+		for (auto &shard : shards)
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			ret += shard.count;
+		}
+		return ret;
+	}
+
+	/**
+	 * @brief Process wide table, used by nodes created outside a parser.
+	 */
+	static const std::shared_ptr<Interner> &global()
+	{
+		static const std::shared_ptr<Interner> instance = std::make_shared<Interner>();
+		return instance;
+	}
+
+private:
+	struct Shard
+	{
+		static constexpr size_t block_size = 256;
+
+		std::mutex mutex;
+		std::vector<const _::InternEntry *> slots; // power of two, at most half full
+		size_t count = 0;
+		std::vector<std::unique_ptr<_::InternEntry[]>> blocks;
+		size_t used = block_size;
+
+		// The shard index took the low bits of the hash, the slot takes the next ones
+		size_t home(uint64_t hash) const { return static_cast<size_t>(hash >> 4) & (slots.size() - 1); }
+
+		// Slot holding key, or the empty slot where it belongs; the table must not be empty
+		const _::InternEntry *&probe(const Key &key)
+		{
+			for (size_t idx = home(key.hash);; idx = (idx + 1) & (slots.size() - 1))
+			{
+				const _::InternEntry *&slot = slots[idx];
+				if (slot == nullptr || (slot->hash == key.hash && slot->text == key.text))
+					return slot;
+			}
+		}
+
+		void grow()
+		{
+			std::vector<const _::InternEntry *> previous(std::max<size_t>(16, slots.size() * 2), nullptr);
+			previous.swap(slots);
+			for (const _::InternEntry *entry : previous)
+			{
+				if (entry == nullptr)
+					continue;
+				size_t idx = home(entry->hash);
+				while (slots[idx] != nullptr)
+					idx = (idx + 1) & (slots.size() - 1);
+				slots[idx] = entry;
+			}
+		}
+
+		const _::InternEntry *insert(const Key &key, const _::InternEntry *&slot)
+		{
+			if (used == block_size)
+			{
+				blocks.emplace_back(new _::InternEntry[block_size]);
+				used = 0;
+			}
+			_::InternEntry &entry = blocks.back()[used++];
+			entry.text.assign(key.text);
+			entry.hash = key.hash;
+			count++;
+			return slot = &entry;
+		}
+	};
+
+	std::array<Shard, 16> shards;
+};
+
+namespace _
+{
+
+	/**
+	 * @brief Orders node maps by (hash, text). Interned keys compare by hash and pointer,
+	 *        the text is only touched on a hash collision or to confirm a match.
+	 */
+	struct KeyLess
+	{
+		using is_transparent = void;
+
+		bool operator()(const Symbol &a, const Symbol &b) const
+		{
+			if (a == b)
+				return false;
+			if (a.hash() != b.hash())
+				return a.hash() < b.hash();
+			return a.view() < b.view();
+		}
+
+		bool operator()(const Symbol &a, const Key &b) const
+		{
+			if (a.hash() != b.hash)
+				return a.hash() < b.hash;
+			return a.view() < b.text;
+		}
+
+		bool operator()(const Key &a, const Symbol &b) const
+		{
+			if (a.hash != b.hash())
+				return a.hash < b.hash();
+			return a.text < b.view();
+		}
+	};
+
+} // namespace _
+} // namespace cwparser
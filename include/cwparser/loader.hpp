@@ -0,0 +1,76 @@
+#pragma once
+
+// Include it explicitly: parses many files or a directory on a ThreadPool.
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+#include "cwparser.hpp"
+
+namespace cwparser
+{
+
+/**
+ * @brief Parse many files on the pool, keyed by path. Files that fail to open are left out of the
+ *        result and, when failed is given, appended to it in input order.
+ *
+ * Every parser shares interner, so key and section names common to the files are stored once and
+ * workers do not fight over the allocator for them. Each worker writes its own slots, nothing else is locked.
+ */
+inline std::map<std::string, cwparser> loadFiles(const std::vector<std::string> &files, ThreadPool &pool,
+												 std::shared_ptr<Interner> interner = std::make_shared<Interner>(),
+												 std::vector<std::string> *failed = nullptr)
+{
+	std::vector<cwparser> parsers(files.size(), cwparser(interner));
+	std::vector<char> loaded(files.size(), 0);
+	// Small files: hand out several per range so the queues are not dominated by scheduling
+	pool.parallelFor(files.size(), [&](size_t begin, size_t end) {
+		for (size_t idx = begin; idx < end; idx++)
+		{
+			std::ifstream file(files[idx], std::ios::binary);
+			loaded[idx] = file.is_open() && parsers[idx].parse(file);
+		}
+	}, std::max<size_t>(1, std::min<size_t>(64, files.size() / (pool.size() * 4))));
+
+	std::map<std::string, cwparser> result;
+	for (size_t idx = 0; idx < files.size(); idx++)
+	{
+		if (loaded[idx])
+			result.emplace(files[idx], std::move(parsers[idx]));
+		else if (failed != nullptr)
+			failed->push_back(files[idx]);
+	}
+	return result;
+}
+
+/**
+ * @brief loadFiles on the regular files of a directory, not recursive. An empty extension takes every
+ *        file, otherwise only those ending with it, e.g. ".cfg".
+ */
+inline std::map<std::string, cwparser> loadDirectory(const std::string &directory, ThreadPool &pool,
+													 std::string_view extension = {},
+													 std::shared_ptr<Interner> interner = std::make_shared<Interner>(),
+													 std::vector<std::string> *failed = nullptr)
+{
+	std::vector<std::string> files;
+	std::error_code error;
+	for (const auto &entry : std::filesystem::directory_iterator(directory, error))
+	{
+		if (!entry.is_regular_file(error))
+			continue;
+		std::string path = entry.path().string();
+		if (extension.empty() || entry.path().extension() == extension)
+			files.push_back(std::move(path));
+	}
+	if (error && failed != nullptr)
+		failed->push_back(directory);
+	std::sort(files.begin(), files.end());
+	return loadFiles(files, pool, std::move(interner), failed);
+}
+
+} // namespace cwparser
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if !defined(CWPARSER_NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CWPARSER_X86_SIMD 1
+#endif
+
+namespace cwparser
+{
+namespace _
+{
+
+	/**
+	 * Numeric array kernels. The widest instruction set of the running CPU is picked once, every level
+	 * computes the same results. Define CWPARSER_NO_SIMD to stay on the scalar code.
+	 */
+	enum class SimdLevel : uint8_t
+	{
+		scalar,
+		sse2,
+		avx2
+	};
+
+	inline SimdLevel detectSimd()
+	{
+#if defined(CWPARSER_X86_SIMD)
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+			return SimdLevel::avx2;
+		if (__builtin_cpu_supports("sse2"))
+			return SimdLevel::sse2;
+#endif
+		return SimdLevel::scalar;
+	}
+
+	inline SimdLevel simdLevel()
+	{
+		static const SimdLevel level = detectSimd();
+		return level;
+	}
+
+	inline bool isDigit(char c) { return static_cast<unsigned char>(c - '0') <= 9; }
+
+#if defined(CWPARSER_X86_SIMD)
+	// Compiler vector types and builtins in place of <immintrin.h>, which alone would cost every file including
+	// the parser more than the rest of it. Unaligned and may alias, like __m128i_u
+	typedef char Bytes16 __attribute__((vector_size(16), may_alias, aligned(1)));
+	typedef char Bytes32 __attribute__((vector_size(32), may_alias, aligned(1)));
+	typedef unsigned char Unsigned16 __attribute__((vector_size(16)));
+	typedef unsigned char Unsigned32 __attribute__((vector_size(32)));
+
+	__attribute__((target("sse2"))) inline size_t countByteSse2(const char *begin, const char *end, char byte)
+	{
+		size_t count = 0;
+		const Bytes16 needle = byte - Bytes16{};
+		for (; end - begin >= 16; begin += 16)
+		{
+			Bytes16 equal = reinterpret_cast<Bytes16>(*reinterpret_cast<const Bytes16 *>(begin) == needle);
+			count += static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(__builtin_ia32_pmovmskb128(equal))));
+		}
+		return count + static_cast<size_t>(std::count(begin, end, byte));
+	}
+
+	__attribute__((target("avx2"))) inline size_t countByteAvx2(const char *begin, const char *end, char byte)
+	{
+		size_t count = 0;
+		const Bytes32 needle = byte - Bytes32{};
+		for (; end - begin >= 32; begin += 32)
+		{
+			Bytes32 equal = reinterpret_cast<Bytes32>(*reinterpret_cast<const Bytes32 *>(begin) == needle);
+			count += static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(__builtin_ia32_pmovmskb256(equal))));
+		}
+		return count + static_cast<size_t>(std::count(begin, end, byte));
+	}
+
+	// A byte is a digit when byte - '0' is at most 9, unsigned
+	__attribute__((target("sse2"))) inline size_t digitRunSse2(const char *begin, const char *end)
+	{
+		const char *pos = begin;
+		for (; end - pos >= 16; pos += 16)
+		{
+			Unsigned16 shifted = reinterpret_cast<Unsigned16>(*reinterpret_cast<const Bytes16 *>(pos)) - '0';
+			Bytes16 digit = reinterpret_cast<Bytes16>(shifted <= 9);
+			unsigned digits = static_cast<unsigned>(__builtin_ia32_pmovmskb128(digit));
+			if (digits != 0xFFFF)
+				return static_cast<size_t>(pos - begin) + static_cast<size_t>(__builtin_ctz(~digits));
+		}
+		while (pos < end && isDigit(*pos))
+			pos++;
+		return static_cast<size_t>(pos - begin);
+	}
+
+	__attribute__((target("avx2"))) inline size_t digitRunAvx2(const char *begin, const char *end)
+	{
+		const char *pos = begin;
+		for (; end - pos >= 32; pos += 32)
+		{
+			Unsigned32 shifted = reinterpret_cast<Unsigned32>(*reinterpret_cast<const Bytes32 *>(pos)) - '0';
+			Bytes32 digit = reinterpret_cast<Bytes32>(shifted <= 9);
+			unsigned digits = static_cast<unsigned>(__builtin_ia32_pmovmskb256(digit));
+			if (digits != 0xFFFFFFFFu)
+				return static_cast<size_t>(pos - begin) + static_cast<size_t>(__builtin_ctz(~digits));
+		}
+		while (pos < end && isDigit(*pos))
+			pos++;
+		return static_cast<size_t>(pos - begin);
+	}
+#endif
+
+	/**
+	 * @brief Occurrences of byte in [begin, end).
+	 */
+	inline size_t countByte(const char *begin, const char *end, char byte, SimdLevel level)
+	{
+#if defined(CWPARSER_X86_SIMD)
+		if (level == SimdLevel::avx2)
+			return countByteAvx2(begin, end, byte);
+		if (level == SimdLevel::sse2)
+			return countByteSse2(begin, end, byte);
+#endif
+		(void)level;
+		return static_cast<size_t>(std::count(begin, end, byte));
+	}
+
+	/**
+	 * @brief Number of decimal digits at the start of [begin, end).
+	 */
+	inline size_t digitRun(const char *begin, const char *end, SimdLevel level)
+	{
+#if defined(CWPARSER_X86_SIMD)
+		if (level == SimdLevel::avx2)
+			return digitRunAvx2(begin, end);
+		if (level == SimdLevel::sse2)
+			return digitRunSse2(begin, end);
+#endif
+		(void)level;
+		const char *pos = begin;
+		while (pos < end && isDigit(*pos))
+			pos++;
+		return static_cast<size_t>(pos - begin);
+	}
+
+	/**
+	 * @brief Value of count decimal digits, eight at a time within a 64 bit register.
+	 */
+	inline uint64_t accumulateDigits(const char *digits, size_t count)
+	{
+		uint64_t value = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		for (; count >= 8; digits += 8, count -= 8)
+		{
+			uint64_t chunk;
+			std::memcpy(&chunk, digits, sizeof(chunk));
+			chunk -= 0x3030303030303030ull;
+			chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FFull;
+			chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFFull;
+			chunk = (chunk * 10000 + (chunk >> 32)) & 0x00000000FFFFFFFFull;
+			value = value * 100000000 + chunk;
+		}
+#endif
+		for (; count > 0; digits++, count--)
+			value = value * 10 + static_cast<uint64_t>(*digits - '0');
+		return value;
+	}
+
+	inline const char *skipBlanks(const char *pos, const char *end)
+	{
+		while (pos < end && (*pos == ' ' || *pos == '\t'))
+			pos++;
+		return pos;
+	}
+
+	/**
+	 * @brief Plain decimal integer element `[-]digits` followed by blanks and a comma or end.
+	 * @return the comma or end, nullptr when the element has any other shape
+	 */
+	template <typename T>
+	inline const char *fastInteger(const char *pos, const char *end, T &out, SimdLevel level)
+	{
+		pos = skipBlanks(pos, end);
+		bool negative = pos < end && *pos == '-';
+		pos += negative;
+		size_t count = digitRun(pos, end, level);
+		if (count == 0 || count > 18)
+			return nullptr;
+		uint64_t magnitude = accumulateDigits(pos, count);
+		pos = skipBlanks(pos + count, end);
+		if (pos != end && *pos != ',')
+			return nullptr;
+		long value = static_cast<long>(magnitude);
+		out = static_cast<T>(negative ? -value : value);
+		return pos;
+	}
+
+	/**
+	 * @brief Decimal element `[-]digits[.digits][e[+-]digits]` within Clinger's fast path: at most 2^53
+	 *        as an integer significand and a power of ten up to 22, so one correctly rounded multiplication
+	 *        or division gives the same double as from_chars.
+	 * @return the comma or end, nullptr when the element is outside this form
+	 */
+	template <typename T>
+	inline const char *fastFloating(const char *pos, const char *end, T &out, SimdLevel level)
+	{
+		static constexpr double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+											1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+		pos = skipBlanks(pos, end);
+		bool negative = pos < end && *pos == '-';
+		pos += negative;
+		size_t count = digitRun(pos, end, level);
+		if (count == 0 || count > 19)
+			return nullptr;
+		uint64_t significand = accumulateDigits(pos, count);
+		pos += count;
+
+		long exponent = 0;
+		if (pos < end && *pos == '.')
+		{
+			size_t fraction = digitRun(++pos, end, level);
+			if (fraction == 0 || count + fraction > 19)
+				return nullptr;
+			for (size_t idx = 0; idx < fraction; idx++)
+				significand *= 10;
+			significand += accumulateDigits(pos, fraction);
+			exponent = -static_cast<long>(fraction);
+			pos += fraction;
+		}
+		if (pos < end && (*pos == 'e' || *pos == 'E'))
+		{
+			pos++;
+			bool below = pos < end && *pos == '-';
+			pos += pos < end && (*pos == '-' || *pos == '+');
+			size_t digits = digitRun(pos, end, level);
+			if (digits == 0 || digits > 4)
+				return nullptr;
+			long power = static_cast<long>(accumulateDigits(pos, digits));
+			exponent += below ? -power : power;
+			pos += digits;
+		}
+		pos = skipBlanks(pos, end);
+		if (pos != end && *pos != ',')
+			return nullptr;
+
+		double value = 0;
+		if (significand != 0)
+		{
+			if (significand > (uint64_t(1) << 53) || exponent < -22 || exponent > 22)
+				return nullptr;
+			value = static_cast<double>(significand);
+			if (exponent > 0)
+				value *= powers[exponent];
+			else if (exponent < 0)
+				value /= powers[-exponent];
+		}
+		out = static_cast<T>(negative ? -value : value);
+		return pos;
+	}
+
+} // namespace _
+} // namespace cwparser
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace cwparser
+{
+namespace _
+{
+
+	struct Update
+	{
+		std::vector<std::string_view> segments; // sections then the key
+		const std::string *value;
+	};
+
+	inline std::vector<std::string_view> splitPath(std::string_view path)
+	{
+		std::vector<std::string_view> segments;
+		while (true)
+		{
+			size_t dot = path.find('.');
+			segments.push_back(path.substr(0, dot));
+			if (dot == std::string_view::npos)
+				return segments;
+			path.remove_prefix(dot + 1);
+		}
+	}
+
+	inline std::shared_ptr<Node> copyNode(const Node &source, const std::shared_ptr<TreeState> &tree)
+	{
+		std::shared_ptr<Node> copy;
+		{
+			ReadGuard guard(source.tree->lock.get());
+			copy = std::make_shared<Node>(source);
+		}
+		copy->tree = tree;
+		return copy;
+	}
+
+	/**
+	 * @brief node itself when nothing below it holds a ${...} reference, otherwise a copy bound to
+	 *        the state of tree, so the values resolve against the new version. Reference-free subtrees stay shared.
+	 */
+	inline std::shared_ptr<Node> relink(const std::shared_ptr<Node> &node, const std::shared_ptr<TreeState> &tree)
+	{
+		bool own = std::any_of(node->properties.begin(), node->properties.end(),
+							   [](const auto &prop) { return prop.second.interpolated; });
+		std::vector<std::pair<Symbol, std::shared_ptr<Node>>> relinked;
+		for (const auto &child : node->children)
+		{
+			auto fresh = relink(child.second, tree);
+			if (fresh != child.second)
+				relinked.emplace_back(child.first, std::move(fresh));
+		}
+		if (!own && relinked.empty())
+			return node;
+
+		auto copy = copyNode(*node, tree);
+		// Same content, the fingerprints stay valid
+		for (auto &child : relinked)
+			copy->children.find(child.first)->second = std::move(child.second);
+		return copy;
+	}
+
+	/**
+	 * @brief Copy source (or start an empty node) and apply the updates reaching it, every child
+	 *        without updates keeps being shared unless relinking asks for the ones holding references.
+	 *        Later updates of the same key win.
+	 */
+	inline std::shared_ptr<Node> rebuild(const Node *source, const std::shared_ptr<TreeState> &tree, bool relinking,
+										 const std::vector<const Update *> &updates, size_t depth)
+	{
+		std::shared_ptr<Node> copy = source != nullptr ? copyNode(*source, tree) : std::make_shared<Node>(tree);
+
+		std::vector<std::pair<std::string_view, std::vector<const Update *>>> groups;
+		for (const Update *update : updates)
+		{
+			std::string_view segment = update->segments[depth];
+			if (update->segments.size() == depth + 1)
+			{
+				copy->setValue(segment, *update->value);
+				continue;
+			}
+			auto group = std::find_if(groups.begin(), groups.end(), [&](const auto &g) { return g.first == segment; });
+			if (group == groups.end())
+				group = groups.insert(groups.end(), {segment, {}});
+			group->second.push_back(update);
+		}
+
+		if (relinking)
+		{
+			for (auto &child : copy->children)
+			{
+				bool updated = std::any_of(groups.begin(), groups.end(), [&](const auto &g) { return g.first == child.first.view(); });
+				if (!updated)
+					child.second = relink(child.second, tree);
+			}
+		}
+
+		for (const auto &group : groups)
+		{
+			auto child = copy->children.find(Key(group.first));
+			const Node *previous = child != copy->children.end() ? child->second.get() : nullptr;
+			copy->setChild(group.first, rebuild(previous, tree, relinking, group.second, depth + 1));
+		}
+		return copy;
+	}
+
+} // namespace _
+
+/**
+ * @brief New root with the updates applied, root itself is left untouched.
+ *
+ * Each update is a dotted path "section.child.key" and a value. Only the nodes on the paths to the
+ * updated keys are copied, once each even when several updates cross them; every other subtree is
+ * shared with root. Missing sections are created. References resolve against the new root: sections
+ * holding ${...} values are copied along with their ancestors, which costs a walk of the tree for
+ * configurations that use references at all.
+ */
+inline std::shared_ptr<Node> withValues(const std::shared_ptr<Node> &root,
+										const std::vector<std::pair<std::string, std::string>> &updates)
+{
+	std::vector<_::Update> parsed;
+	parsed.reserve(updates.size());
+	for (const auto &update : updates)
+		parsed.push_back({_::splitPath(update.first), &update.second});
+
+	std::vector<const _::Update *> pending;
+	for (const auto &update : parsed)
+		pending.push_back(&update);
+	const _::TreeState &source = *root->tree;
+	auto tree = std::make_shared<_::TreeState>(_::TreeState{source.interner, nullptr, nullptr});
+	bool relinking = source.references && source.references->interpolating();
+	if (source.references)
+		tree->references = std::make_shared<_::References>();
+	if (relinking)
+		tree->references->noteInterpolated();
+	// A new version gets its own lock, the subtrees it shares keep the one of the tree they come from
+	if (source.lock)
+		tree->lock = std::make_shared<_::TreeLock>();
+	auto result = _::rebuild(root.get(), tree, relinking, pending, 0);
+	if (tree->references)
+		tree->references->setRoot(result);
+	return result;
+}
+
+} // namespace cwparser
@@ -0,0 +1,238 @@
+#pragma once
+
+// Include it explicitly for the report, the hooks are compiled in with -DCWPARSER_PROFILE.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
+#include "cwparser.hpp"
+
+namespace cwparser
+{
+
+/**
+ * @brief Lookups on one key of one node with one target type, see Profiler.
+ */
+struct ProfileEntry
+{
+	std::string path;     // dotted path, "?" stands for a node no parsed tree holds anymore
+	std::string type;     // requested type, "section" for operator[]
+	uint64_t calls = 0;
+	uint64_t convert_ns = 0;
+};
+
+namespace _
+{
+
+	struct ProfileSlot
+	{
+		const Node *node;
+		uint64_t key_hash;
+		const std::type_info *type;
+
+		bool operator==(const ProfileSlot &other) const
+		{
+			return node == other.node && key_hash == other.key_hash && type == other.type;
+		}
+	};
+
+	struct ProfileSlotHash
+	{
+		size_t operator()(const ProfileSlot &slot) const
+		{
+			return static_cast<size_t>(mix(slot.key_hash ^ reinterpret_cast<uintptr_t>(slot.node) ^
+										   (reinterpret_cast<uintptr_t>(slot.type) << 1)));
+		}
+	};
+
+	struct ProfileCounters
+	{
+		std::string key;
+		uint64_t calls = 0;
+		uint64_t convert_ns = 0;
+	};
+
+	/**
+	 * @brief Counters of one thread. Only its thread writes, the lock is uncontended but for reports.
+	 */
+	struct ProfileTable
+	{
+		std::mutex mutex;
+		std::unordered_map<ProfileSlot, ProfileCounters, ProfileSlotHash> slots;
+	};
+
+	struct ProfileRegistry
+	{
+		std::mutex mutex;
+		std::vector<std::shared_ptr<ProfileTable>> tables;
+		std::vector<std::weak_ptr<const Node>> roots;
+
+		static ProfileRegistry &instance()
+		{
+			static ProfileRegistry registry;
+			return registry;
+		}
+
+		ProfileTable &local()
+		{
+			thread_local std::shared_ptr<ProfileTable> table = [this] {
+				auto created = std::make_shared<ProfileTable>();
+				std::lock_guard<std::mutex> lock(mutex);
+				tables.push_back(created);
+				return created;
+			}();
+			return *table;
+		}
+	};
+
+	inline std::string typeName(const std::type_info *type)
+	{
+		if (type == nullptr)
+			return "section";
+#if defined(__GNUG__)
+		int status = 0;
+		std::unique_ptr<char, void (*)(void *)> name(abi::__cxa_demangle(type->name(), nullptr, nullptr, &status), std::free);
+		if (status == 0 && name)
+			return name.get();
+#endif
+		return type->name();
+	}
+
+	inline void collectPaths(const Node &node, const std::string &path, std::unordered_map<const Node *, std::string> &paths)
+	{
+		paths.emplace(&node, path);
+		for (const auto &child : node.children)
+			collectPaths(*child.second, path.empty() ? std::string(child.first.view()) : path + "." + std::string(child.first.view()), paths);
+	}
+
+#ifdef CWPARSER_PROFILE
+	inline void profileRecord(const Node *node, const Key &key, const std::type_info *type, uint64_t convert_ns)
+	{
+		ProfileTable &table = ProfileRegistry::instance().local();
+		std::lock_guard<std::mutex> lock(table.mutex);
+		auto it = table.slots.find({node, key.hash, type});
+		if (it == table.slots.end())
+			it = table.slots.emplace(ProfileSlot{node, key.hash, type}, ProfileCounters{std::string(key.text), 0, 0}).first;
+		it->second.calls++;
+		it->second.convert_ns += convert_ns;
+	}
+
+	inline void profileWatch(std::weak_ptr<const Node> root)
+	{
+		ProfileRegistry &registry = ProfileRegistry::instance();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		registry.roots.erase(std::remove_if(registry.roots.begin(), registry.roots.end(),
+			[](const std::weak_ptr<const Node> &tree) { return tree.expired(); }), registry.roots.end());
+		registry.roots.push_back(std::move(root));
+	}
+#endif
+
+} // namespace _
+
+/**
+ * @brief Per-key counts of Node::get, try_get and operator[] calls, with the time spent converting.
+ *
+ * Compiled in only when CWPARSER_PROFILE is defined, otherwise the hooks vanish and the report is empty.
+ * Each thread counts into its own table. Paths are named after the trees parsed since, nodes built by
+ * hand show as "?".
+ */
+class Profiler
+{
+public:
+	/**
+	 * @brief Merged counters of every thread, most called first.
+	 */
+	static std::vector<ProfileEntry> entries()
+	{
+		_::ProfileRegistry &registry = _::ProfileRegistry::instance();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+
+		std::unordered_map<const Node *, std::string> paths;
+		for (const auto &root : registry.roots)
+		{
+			if (auto tree = root.lock())
+				_::collectPaths(*tree, {}, paths);
+		}
+
+		std::unordered_map<std::string, ProfileEntry> merged;
+		for (const auto &table : registry.tables)
+		{
+			std::lock_guard<std::mutex> table_lock(table->mutex);
+			for (const auto &slot : table->slots)
+			{
+				auto node = paths.find(slot.first.node);
+				std::string prefix = node != paths.end() ? node->second : "?";
+				std::string path = prefix.empty() ? slot.second.key : prefix + "." + slot.second.key;
+				std::string type = _::typeName(slot.first.type);
+
+				ProfileEntry &entry = merged[path + '\0' + type];
+				entry.path = std::move(path);
+				entry.type = std::move(type);
+				entry.calls += slot.second.calls;
+				entry.convert_ns += slot.second.convert_ns;
+			}
+		}
+
+		std::vector<ProfileEntry> result;
+		for (auto &entry : merged)
+			result.push_back(std::move(entry.second));
+		std::sort(result.begin(), result.end(), [](const ProfileEntry &a, const ProfileEntry &b) {
+			return a.calls != b.calls ? a.calls > b.calls : a.path < b.path;
+		});
+		return result;
+	}
+
+	/**
+	 * @brief Name of a target type as entries() spells it.
+	 */
+	static std::string typeName(const std::type_info &type) { return _::typeName(&type); }
+
+	static void report(std::ostream &out)
+	{
+		auto all = entries();
+		out << "cwparser profile, " << all.size() << " entries\n";
+		out << std::setw(12) << "calls" << std::setw(14) << "convert ms" << "  " << std::left << std::setw(24) << "type"
+			<< "path\n" << std::right;
+		for (const auto &entry : all)
+		{
+			out << std::setw(12) << entry.calls << std::setw(14) << std::fixed << std::setprecision(3)
+				<< entry.convert_ns / 1e6 << "  " << std::left << std::setw(24) << entry.type << entry.path << "\n"
+				<< std::right;
+		}
+		out << std::flush;
+	}
+
+	/**
+	 * @brief Print the report to std::cerr when the program exits.
+	 */
+	static void reportAtExit()
+	{
+		std::atexit([] { report(std::cerr); });
+	}
+
+	static void reset()
+	{
+		_::ProfileRegistry &registry = _::ProfileRegistry::instance();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		for (const auto &table : registry.tables)
+		{
+			std::lock_guard<std::mutex> table_lock(table->mutex);
+			table->slots.clear();
+		}
+	}
+};
+
+} // namespace cwparser
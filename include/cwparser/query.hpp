@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cwparser
+{
+namespace _
+{
+
+	/**
+	 * @brief Glob match of one path segment, '*' matches any run of characters and '?' one character.
+	 */
+	inline bool globMatch(std::string_view pattern, std::string_view text)
+	{
+		size_t p = 0, t = 0, star = std::string_view::npos, retry = 0;
+		while (t < text.size())
+		{
+			if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t]))
+			{
+				p++;
+				t++;
+			}
+			else if (p < pattern.size() && pattern[p] == '*')
+			{
+				star = p++;
+				retry = t;
+			}
+			else if (star != std::string_view::npos)
+			{
+				p = star + 1;
+				t = ++retry;
+			}
+			else
+				return false;
+		}
+		while (p < pattern.size() && pattern[p] == '*')
+			p++;
+		return p == pattern.size();
+	}
+
+	struct Segment
+	{
+		std::string_view text;
+		std::string_view prefix; // literal part before the first wildcard, bounds the range scan
+		bool any_depth = false;  // "**"
+		bool literal = false;
+	};
+
+} // namespace _
+
+/**
+ * @brief Lazy result of Node::select / cwparser::select.
+ *
+ * The pattern is a dotted path whose last segment matches property keys and the others section names.
+ * A segment may use '*' and '?' wildcards, "**" matches any number of nested sections:
+ * @code
+ * config.select("sensors.*.rate");    // rate of every direct child of sensors
+ * config.select("system.thread_*");   // keys starting with thread_ in system
+ * config.select("**.port");           // port at any depth
+ * @endcode
+ * Each segment is resolved against the node's sorted key index, so literal prefixes become range scans.
+ * Matches are produced one at a time while iterating, nothing is collected up front.
+ * The selection borrows the tree, which must not be modified while iterating.
+ */
+class Selection
+{
+public:
+	struct Match
+	{
+		const Node *node;
+		Symbol key;
+		const Value *value;
+
+		template <typename T>
+		auto get() const { return node->get<T>(key); }
+	};
+
+	class iterator
+	{
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = Match;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const Match *;
+		using reference = const Match &;
+
+		iterator() = default;
+
+		const Match &operator*() const { return current; }
+		const Match *operator->() const { return &current; }
+
+		iterator &operator++()
+		{
+			advance();
+			return *this;
+		}
+
+		bool operator==(const iterator &other) const { return stack.empty() == other.stack.empty() && (stack.empty() || current.value == other.current.value); }
+		bool operator!=(const iterator &other) const { return !(*this == other); }
+
+		/**
+		 * @brief Dotted path of the current match, e.g. "sensors.front.rate".
+		 */
+		std::string path() const
+		{
+			std::string ret;
+			for (const auto &frame : stack)
+			{
+				if (!frame.name)
+					continue;
+				ret.append(frame.name.view());
+				ret.push_back('.');
+			}
+			ret.append(current.key.view());
+			return ret;
+		}
+
+	private:
+		friend class Selection;
+
+		struct Frame
+		{
+			const Node *node;
+			Symbol name;     // edge taken from the parent, empty when the node did not change
+			size_t segment;
+			size_t pos, end; // cursor over the sorted children, or properties on the last segment
+			bool expanded;   // "**" already tried matching zero levels
+		};
+
+		const std::vector<_::Segment> *segments = nullptr;
+		std::vector<Frame> stack;
+		Match current{};
+
+		iterator(const Node &root, const std::vector<_::Segment> &segments) : segments(&segments)
+		{
+			push(root, Symbol(), 0);
+			advance();
+		}
+
+		void push(const Node &node, Symbol name, size_t segment)
+		{
+			const _::Segment &seg = (*segments)[segment];
+			const _::KeyIndex &index = node.keyIndex();
+			const std::vector<Symbol> &keys = (segment + 1 == segments->size()) ? index.properties : index.children;
+
+			Frame frame{&node, name, segment, 0, keys.size(), false};
+			if (!seg.any_depth && !seg.prefix.empty())
+			{
+				auto first = std::lower_bound(keys.begin(), keys.end(), seg.prefix,
+					[](const Symbol &key, std::string_view prefix) { return key.view() < prefix; });
+				auto last = std::find_if(first, keys.end(),
+					[&](const Symbol &key) { return key.view().substr(0, seg.prefix.size()) != seg.prefix; });
+				frame.pos = first - keys.begin();
+				frame.end = last - keys.begin();
+			}
+			stack.push_back(frame);
+		}
+
+		void advance()
+		{
+			while (!stack.empty())
+			{
+				Frame &frame = stack.back();
+				const _::Segment &seg = (*segments)[frame.segment];
+				const _::KeyIndex &index = frame.node->keyIndex();
+
+				if (frame.segment + 1 == segments->size())
+				{
+					while (frame.pos < frame.end)
+					{
+						Symbol key = index.properties[frame.pos++];
+						if (seg.literal ? key.view() == seg.text : _::globMatch(seg.text, key.view()))
+						{
+							current = Match{frame.node, key, &frame.node->properties.find(key)->second};
+							return;
+						}
+					}
+					stack.pop_back();
+					continue;
+				}
+
+				if (seg.any_depth && !frame.expanded)
+				{
+					frame.expanded = true;
+					push(*frame.node, Symbol(), frame.segment + 1);
+					continue;
+				}
+
+				if (frame.pos < frame.end)
+				{
+					Symbol name = index.children[frame.pos++];
+					if (seg.any_depth)
+						push(*frame.node->children.find(name)->second, name, frame.segment);
+					else if (seg.literal ? name.view() == seg.text : _::globMatch(seg.text, name.view()))
+						push(*frame.node->children.find(name)->second, name, frame.segment + 1);
+					continue;
+				}
+				stack.pop_back();
+			}
+		}
+	};
+
+	Selection(const Node &root, std::string_view pattern) : root(&root), pattern(pattern)
+	{
+		std::string_view rest = this->pattern;
+		while (true)
+		{
+			size_t dot = rest.find('.');
+			addSegment(rest.substr(0, dot));
+			if (dot == std::string_view::npos)
+				break;
+			rest.remove_prefix(dot + 1);
+		}
+		// A trailing "**" selects every property below
+		if (segments.back().any_depth)
+			addSegment("*");
+	}
+
+	Selection(const Selection &other) : Selection(*other.root, other.pattern) {}
+	Selection &operator=(const Selection &) = delete;
+
+	iterator begin() const { return iterator(*root, segments); }
+	iterator end() const { return iterator(); }
+
+private:
+	const Node *root;
+	std::string pattern;
+	std::vector<_::Segment> segments;
+
+	void addSegment(std::string_view text)
+	{
+		_::Segment seg;
+		seg.text = text;
+		seg.any_depth = text == "**";
+		size_t wildcard = text.find_first_of("*?");
+		seg.literal = wildcard == std::string_view::npos;
+		seg.prefix = text.substr(0, wildcard);
+		segments.push_back(seg);
+	}
+};
+
+} // namespace cwparser
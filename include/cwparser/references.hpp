@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+namespace cwparser
+{
+namespace _
+{
+
+	/**
+	 * @brief Property a "section.child.key" reference points to, null when missing.
+	 */
+	inline const Value *lookupPath(const Node &tree, std::string_view path)
+	{
+		const Node *node = &tree;
+		path = trim(path);
+		for (size_t dot = path.find('.'); dot != std::string_view::npos; dot = path.find('.'))
+		{
+			auto child = node->children.find(Key(path.substr(0, dot)));
+			if (child == node->children.end())
+				return nullptr;
+			node = child->second.get();
+			path.remove_prefix(dot + 1);
+		}
+		auto prop = node->properties.find(Key(path));
+		return prop != node->properties.end() ? &prop->second : nullptr;
+	}
+
+	inline Status References::resolve(const Value &value, std::string_view &text)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto tree = root.lock();
+		if (!tree)
+		{
+			text = value.text();
+			return {};
+		}
+
+		const std::string *expanded = nullptr;
+		visiting.clear();
+		Status status = expand(*tree, value, expanded);
+		if (status)
+			text = *expanded;
+		return status;
+	}
+
+	inline Status References::expand(const Node &tree, const Value &value, const std::string *&out)
+	{
+		auto cached = memo.find(&value);
+		if (cached != memo.end())
+		{
+			out = &cached->second;
+			return {};
+		}
+		if (std::find(visiting.begin(), visiting.end(), &value) != visiting.end())
+			return {ErrorCode::reference_cycle, 0};
+		visiting.push_back(&value);
+
+		std::string_view text = value.text();
+		std::string result;
+		size_t pos = 0;
+		for (size_t open = text.find("${"); open != std::string_view::npos; open = text.find("${", pos))
+		{
+			size_t close = text.find('}', open + 2);
+			if (close == std::string_view::npos)
+				break;
+			result.append(text.substr(pos, open - pos));
+
+			const Value *target = lookupPath(tree, text.substr(open + 2, close - open - 2));
+			Status status = target != nullptr ? Status{} : Status{ErrorCode::missing_key, open};
+			const std::string *nested = target != nullptr ? &target->text() : nullptr;
+			if (status && target->interpolated)
+				status = expand(tree, *target, nested);
+			if (!status)
+			{
+				visiting.pop_back();
+				return {status.code, open};
+			}
+			result.append(*nested);
+			pos = close + 1;
+		}
+		result.append(text.substr(pos));
+
+		visiting.pop_back();
+		out = &memo.emplace(&value, std::move(result)).first->second;
+		memoized.store(true, std::memory_order_release);
+		return {};
+	}
+
+} // namespace _
+} // namespace cwparser
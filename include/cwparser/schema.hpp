@@ -0,0 +1,289 @@
+#pragma once
+
+// Include it explicitly: validates and types a file while it is parsed.
+
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "cwparser.hpp"
+
+namespace cwparser
+{
+namespace _
+{
+
+	struct KeyRule
+	{
+		std::string key;
+		bool required;
+		std::function<Status(std::string_view, Scalar &)> convert;
+	};
+
+	/**
+	 * @brief Rules of one section, keys are looked up by hash while parsing.
+	 */
+	struct SectionRule
+	{
+		std::string path;
+		std::vector<KeyRule> keys;
+		std::unordered_map<uint64_t, uint32_t> lookup;
+		uint32_t required = 0;
+
+		const KeyRule *find(std::string_view key, uint32_t &index) const
+		{
+			auto it = lookup.find(hash(key));
+			if (it == lookup.end() || keys[it->second].key != key)
+				return nullptr;
+			index = it->second;
+			return &keys[index];
+		}
+	};
+
+} // namespace _
+
+/**
+ * @brief Expected sections and keys, with their types and ranges, checked by cwparser::parse.
+ * @code
+ * cwparser::Schema schema;
+ * schema.section("network.server").required<int>("port", 1, 65535).optional<std::string>("host");
+ * @endcode
+ * Keys and sections that are not declared are accepted as they are.
+ */
+class Schema
+{
+public:
+	class Section
+	{
+	public:
+		template <typename T>
+		Section &required(std::string_view key) { return add(key, true, convert<T>()); }
+
+		template <typename T>
+		Section &required(std::string_view key, T min, T max) { return add(key, true, convert<T>(min, max)); }
+
+		template <typename T>
+		Section &optional(std::string_view key) { return add(key, false, convert<T>()); }
+
+		template <typename T>
+		Section &optional(std::string_view key, T min, T max) { return add(key, false, convert<T>(min, max)); }
+
+	private:
+		friend class Schema;
+		explicit Section(_::SectionRule &rule) : rule(rule) {}
+
+		_::SectionRule &rule;
+
+		template <typename T>
+		static auto convert()
+		{
+			return [](std::string_view text, Scalar &slot) -> _::Status { return store<T>(text, slot, nullptr, nullptr); };
+		}
+
+		template <typename T>
+		static auto convert(T min, T max)
+		{
+			static_assert(std::is_arithmetic<T>::value, "ranges apply to numbers");
+			return [min, max](std::string_view text, Scalar &slot) -> _::Status { return store<T>(text, slot, &min, &max); };
+		}
+
+		/**
+		 * @brief Numbers are read as long or double, checked against T and the range, and stored at that
+		 *        width, so a get of any type reads from the slot what it would read from the text.
+		 */
+		template <typename T>
+		static _::Status store(std::string_view text, Scalar &slot, const T *min, const T *max)
+		{
+			constexpr bool integer = std::is_integral<T>::value && !std::is_same<T, bool>::value;
+			using Wide = typename std::conditional<integer, long,
+				typename std::conditional<std::is_floating_point<T>::value, double, T>::type>::type;
+
+			Wide value{};
+			_::Status status = _::try_from_string(text, value);
+			if (!status)
+				return status;
+
+			bool fits = true;
+			if constexpr (integer)
+				fits = _::fitsIn<T>(value);
+			else if constexpr (std::is_floating_point<T>::value)
+				fits = !std::isfinite(value) || std::fabs(value) <= static_cast<double>(std::numeric_limits<T>::max());
+			if constexpr (std::is_arithmetic<T>::value)
+			{
+				if (!fits || (min != nullptr && (static_cast<T>(value) < *min || *max < static_cast<T>(value))))
+					return {ErrorCode::out_of_range, _::skipSpaces(text)};
+			}
+			_::toScalar(value, slot);
+			return status;
+		}
+
+		Section &add(std::string_view key, bool required, std::function<_::Status(std::string_view, Scalar &)> convert)
+		{
+			uint32_t index = 0;
+			if (rule.find(key, index) == nullptr)
+			{
+				index = static_cast<uint32_t>(rule.keys.size());
+				rule.keys.push_back({std::string(key), false, {}});
+				rule.lookup.emplace(_::hash(key), index);
+			}
+			_::KeyRule &entry = rule.keys[index];
+			rule.required += static_cast<uint32_t>(required) - static_cast<uint32_t>(entry.required);
+			entry.required = required;
+			entry.convert = std::move(convert);
+			return *this;
+		}
+	};
+
+	/**
+	 * @brief Rules for the section at a dotted path, e.g. "network.server". Declaring it again adds to it.
+	 */
+	Section section(std::string_view path)
+	{
+		auto it = sections.find(_::hash(path));
+		if (it == sections.end())
+			it = sections.emplace(_::hash(path), _::SectionRule{std::string(path), {}, {}, 0}).first;
+		return Section(it->second);
+	}
+
+	const _::SectionRule *find(std::string_view path) const
+	{
+		auto it = sections.find(_::hash(path));
+		return it != sections.end() && it->second.path == path ? &it->second : nullptr;
+	}
+
+	const std::unordered_map<uint64_t, _::SectionRule> &rules() const { return sections; }
+
+private:
+	std::unordered_map<uint64_t, _::SectionRule> sections;
+};
+
+/**
+ * @brief Why a parse against a Schema stopped. A missing required key has no line, section and key
+ *        name it instead, e.g. "network.server" and "port"; other errors locate the offending value.
+ */
+struct SchemaError : Error
+{
+	std::string section;
+	std::string key;
+};
+
+/**
+ * @brief TreeBuilder that checks each property against the schema as it is stored.
+ */
+struct cwparser::SchemaBuilder : TreeBuilder
+{
+	struct Frame
+	{
+		const _::SectionRule *rule;
+		std::vector<bool> seen;
+		std::string path;
+	};
+
+	const Schema &schema;
+	std::vector<Frame> frames;
+	std::unordered_set<const _::SectionRule *> opened;
+	SchemaError error;
+
+	bool stop() const { return error.code != ErrorCode::ok; }
+
+	void on_section_begin(std::string_view name, size_t depth)
+	{
+		TreeBuilder::on_section_begin(name, depth);
+		frames.resize(depth);
+		std::string path = frames.empty() ? std::string(name) : frames.back().path + "." + std::string(name);
+		const _::SectionRule *rule = schema.find(path);
+		if (rule != nullptr)
+			opened.insert(rule);
+		frames.push_back({rule, std::vector<bool>(rule != nullptr ? rule->keys.size() : 0), std::move(path)});
+	}
+
+	void on_property(std::string_view key, std::string_view value, Location location)
+	{
+		Value &stored = current->setValue(key, std::string(value), location);
+		Frame &frame = frames.back();
+		uint32_t index = 0;
+		const _::KeyRule *rule = frame.rule != nullptr ? frame.rule->find(key, index) : nullptr;
+		if (rule == nullptr)
+		{
+			if (typed && !stored.interpolated)
+				classify(*current, stored);
+			return;
+		}
+
+		frame.seen[index] = true;
+		// References are only known once the whole file is read, they are converted on access
+		if (stored.interpolated)
+			return;
+		Scalar scalar;
+		_::Status status = rule->convert(value, scalar);
+		if (!status)
+			fail(location, status);
+		else if (scalar.kind != Scalar::Kind::none || stored.slot != 0)
+			current->typedSlot(stored) = scalar;
+	}
+
+	void on_section_end(std::string_view, size_t depth)
+	{
+		const Frame &frame = frames[depth];
+		if (frame.rule == nullptr)
+			return;
+		for (size_t idx = 0; idx < frame.rule->keys.size() && !stop(); idx++)
+		{
+			if (frame.rule->keys[idx].required && !frame.seen[idx])
+				missing(frame.path, frame.rule->keys[idx].key);
+		}
+	}
+
+	/**
+	 * @brief Sections with required keys that never appeared.
+	 */
+	void finish()
+	{
+		for (const auto &section : schema.rules())
+		{
+			if (stop())
+				return;
+			if (section.second.required == 0 || opened.count(&section.second) != 0)
+				continue;
+			for (const auto &key : section.second.keys)
+			{
+				if (key.required)
+				{
+					missing(section.second.path, key.key);
+					break;
+				}
+			}
+		}
+	}
+
+	void fail(Location location, const _::Status &status)
+	{
+		static_cast<Error &>(error) = _::locate(location, status);
+	}
+
+	void missing(const std::string &section, const std::string &key)
+	{
+		error.code = ErrorCode::missing_key;
+		error.section = section;
+		error.key = key;
+	}
+};
+
+inline bool cwparser::parse(std::istream &in, const Schema &schema, SchemaError *error)
+{
+	root = std::make_shared<Node>(interner);
+	SchemaBuilder builder{{*interner, root, {}, root, eager_typing}, schema, {}, {}, {}};
+	bool read = build(in, builder);
+	if (!builder.stop())
+		builder.finish();
+	if (error != nullptr)
+		*error = builder.error;
+	return read && !builder.stop();
+}
+
+} // namespace cwparser
@@ -0,0 +1,244 @@
+#pragma once
+
+// POSIX only, include it explicitly: publishes frozen trees in shared memory for other processes.
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cwparser.hpp"
+
+namespace cwparser
+{
+namespace _
+{
+
+	/**
+	 * Control segment "<name>": the generation of the latest publication, whose frozen block lives
+	 * in its own segment "<name>.<generation>". Segments of older generations are unlinked once
+	 * replaced, processes that mapped them keep them until they let go.
+	 */
+	struct SharedControl
+	{
+		char magic[8];
+		uint32_t version;
+		std::atomic<uint64_t> generation;
+	};
+
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "the generation counter must be lock free across processes");
+
+	constexpr char shared_magic[8] = {'c', 'w', 'p', 's', 'h', 'm', '\0', '\0'};
+	constexpr uint32_t shared_version = 1;
+
+	[[noreturn]] inline void throw_system(const std::string &what)
+	{
+		throw std::system_error(errno, std::generic_category(), what);
+	}
+
+	inline std::string segmentName(const std::string &name, uint64_t generation)
+	{
+		return name + "." + std::to_string(generation);
+	}
+
+	/**
+	 * @brief Map a whole segment, the mapping is released with the last copy of the pointer.
+	 */
+	inline std::shared_ptr<void> mapSegment(int fd, size_t size, int protection)
+	{
+		void *address = mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+		if (address == MAP_FAILED)
+			return nullptr;
+		return std::shared_ptr<void>(address, [size](void *ptr) { munmap(ptr, size); });
+	}
+
+} // namespace _
+
+/**
+ * @brief Writes frozen trees into POSIX shared memory under a name, e.g. "/service_config".
+ *
+ * Every publish() goes to a fresh segment and then bumps the generation, readers never see a block
+ * being written. Destroying the publisher removes the names, attached readers keep their mapping.
+ */
+class SharedPublisher
+{
+public:
+	explicit SharedPublisher(std::string name) : name(std::move(name))
+	{
+		int fd = shm_open(this->name.c_str(), O_CREAT | O_RDWR, 0644);
+		if (fd < 0)
+			_::throw_system("shm_open " + this->name);
+		struct stat info{};
+		bool fresh = fstat(fd, &info) == 0 && info.st_size == 0;
+		if (fresh && ftruncate(fd, sizeof(_::SharedControl)) != 0)
+		{
+			close(fd);
+			_::throw_system("ftruncate " + this->name);
+		}
+		mapping = _::mapSegment(fd, sizeof(_::SharedControl), PROT_READ | PROT_WRITE);
+		close(fd);
+		if (!mapping)
+			_::throw_system("mmap " + this->name);
+
+		control = static_cast<_::SharedControl *>(mapping.get());
+		if (fresh || std::memcmp(control->magic, _::shared_magic, sizeof(control->magic)) != 0)
+		{
+			// Left over by a publisher that died: generations go on from where it stopped
+			std::memcpy(control->magic, _::shared_magic, sizeof(control->magic));
+			control->version = _::shared_version;
+			if (fresh)
+				new (&control->generation) std::atomic<uint64_t>(0);
+		}
+		generation = control->generation.load(std::memory_order_acquire);
+	}
+
+	~SharedPublisher()
+	{
+		if (generation != 0)
+			shm_unlink(_::segmentName(name, generation).c_str());
+		shm_unlink(name.c_str());
+	}
+
+	SharedPublisher(const SharedPublisher &) = delete;
+	SharedPublisher &operator=(const SharedPublisher &) = delete;
+
+	/**
+	 * @brief Publish a new generation, throws std::system_error when the segment cannot be written.
+	 * @return the generation readers will switch to
+	 */
+	uint64_t publish(const Frozen &frozen)
+	{
+		uint64_t next = generation + 1;
+		std::string segment = _::segmentName(name, next);
+		shm_unlink(segment.c_str());
+		int fd = shm_open(segment.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+		if (fd < 0)
+			_::throw_system("shm_open " + segment);
+		if (ftruncate(fd, static_cast<off_t>(frozen.bytes())) != 0)
+		{
+			close(fd);
+			shm_unlink(segment.c_str());
+			_::throw_system("ftruncate " + segment);
+		}
+		auto block = _::mapSegment(fd, frozen.bytes(), PROT_READ | PROT_WRITE);
+		close(fd);
+		if (!block)
+		{
+			shm_unlink(segment.c_str());
+			_::throw_system("mmap " + segment);
+		}
+		std::memcpy(block.get(), frozen.data(), frozen.bytes());
+		block.reset();
+
+		control->generation.store(next, std::memory_order_release);
+		if (generation != 0)
+			shm_unlink(_::segmentName(name, generation).c_str());
+		generation = next;
+		return next;
+	}
+
+	uint64_t published() const { return generation; }
+
+private:
+	std::string name;
+	std::shared_ptr<void> mapping;
+	_::SharedControl *control = nullptr;
+	uint64_t generation = 0;
+};
+
+/**
+ * @brief Read-only view of the latest tree published under a name, served straight from shared memory.
+ *
+ * Lookups go through FrozenNode and take no lock. refresh() is a single atomic load when nothing changed;
+ * it swaps the view, so call it from one thread or keep the Frozen returned by current() while reading.
+ */
+class SharedConfig
+{
+public:
+	/**
+	 * @brief Attach to a publisher's name, throws std::system_error when there is none.
+	 */
+	explicit SharedConfig(std::string name) : name(std::move(name))
+	{
+		int fd = shm_open(this->name.c_str(), O_RDONLY, 0);
+		if (fd < 0)
+			_::throw_system("shm_open " + this->name);
+		mapping = _::mapSegment(fd, sizeof(_::SharedControl), PROT_READ);
+		close(fd);
+		if (!mapping)
+			_::throw_system("mmap " + this->name);
+		control = static_cast<const _::SharedControl *>(mapping.get());
+		if (std::memcmp(control->magic, _::shared_magic, sizeof(control->magic)) != 0 || control->version != _::shared_version)
+			throw std::runtime_error("Not a cwparser publication: " + this->name);
+		refresh();
+	}
+
+	/**
+	 * @brief Switch to the latest generation.
+	 * @return true when a newer one was attached
+	 */
+	bool refresh()
+	{
+		uint64_t latest = control->generation.load(std::memory_order_acquire);
+		// The publisher may replace a generation between the load and the open, follow it
+		while (latest != attached && latest != 0)
+		{
+			if (attach(latest))
+				return true;
+			uint64_t again = control->generation.load(std::memory_order_acquire);
+			if (again == latest)
+				return false;
+			latest = again;
+		}
+		return false;
+	}
+
+	uint64_t generation() const { return attached; }
+
+	const Frozen &current() const { return frozen; }
+	FrozenNode root() const { return frozen.root(); }
+	FrozenNode operator[](const Key &nodePath) const { return frozen[nodePath]; }
+
+	explicit operator bool() const { return bool(frozen); }
+
+private:
+	std::string name;
+	std::shared_ptr<void> mapping;
+	const _::SharedControl *control = nullptr;
+	uint64_t attached = 0;
+	Frozen frozen;
+
+	bool attach(uint64_t generation)
+	{
+		std::string segment = _::segmentName(name, generation);
+		int fd = shm_open(segment.c_str(), O_RDONLY, 0);
+		if (fd < 0)
+			return false;
+		struct stat info{};
+		std::shared_ptr<void> block;
+		if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(_::FrozenHeader))
+			block = _::mapSegment(fd, static_cast<size_t>(info.st_size), PROT_READ);
+		close(fd);
+		if (!block)
+			return false;
+
+		const auto *header = static_cast<const _::FrozenHeader *>(block.get());
+		if (std::memcmp(header->magic, _::frozen_magic, sizeof(header->magic)) != 0 ||
+			header->version != _::frozen_version || header->total_bytes > static_cast<uint64_t>(info.st_size))
+			return false;
+
+		const char *base = static_cast<const char *>(block.get());
+		frozen = Frozen(std::move(block), base);
+		attached = generation;
+		return true;
+	}
+};
+
+} // namespace cwparser
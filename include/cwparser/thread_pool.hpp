@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cwparser
+{
+
+/**
+ * @brief Fixed set of workers running fork-join loops.
+ *
+ * parallelFor splits the range in chunks dealt round-robin to per-worker queues. A worker drains its own
+ * queue from the front and, once empty, steals from the back of the others, so uneven chunks balance out.
+ * The calling thread works too. One loop runs at a time, concurrent callers are serialized.
+ */
+class ThreadPool
+{
+public:
+	explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency())
+	{
+		threads = std::max(1u, threads);
+		for (unsigned idx = 0; idx < threads; idx++)
+			queues.push_back(std::make_unique<Queue>());
+		for (unsigned idx = 1; idx < threads; idx++)
+			workers.emplace_back([this, idx] { run(idx); });
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		wake.notify_all();
+		for (auto &worker : workers)
+			worker.join();
+	}
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	unsigned size() const { return static_cast<unsigned>(queues.size()); }
+
+	/**
+	 * @brief Call body(begin, end) over sub-ranges covering [0, count), rethrows the first exception.
+	 */
+	template <typename Body>
+	void parallelFor(size_t count, Body &&body, size_t grain = 0)
+	{
+		if (count == 0)
+			return;
+		if (grain == 0)
+			grain = std::max<size_t>(1, count / (size() * 8));
+
+		std::lock_guard<std::mutex> submit(submitting);
+		size_t chunks = (count + grain - 1) / grain;
+		{
+			// Published before any range, a worker still draining the previous loop may grab one at once
+			std::lock_guard<std::mutex> lock(mutex);
+			job = [&body](size_t begin, size_t end) { body(begin, end); };
+			error = nullptr;
+			pending = chunks;
+		}
+		for (size_t idx = 0; idx < chunks; idx++)
+		{
+			Queue &queue = *queues[idx % queues.size()];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.ranges.emplace_back(idx * grain, std::min(count, (idx + 1) * grain));
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			generation++;
+		}
+		wake.notify_all();
+
+		work(0);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this] { return pending == 0; });
+		job = nullptr;
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<std::pair<size_t, size_t>> ranges;
+	};
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+
+	std::mutex submitting;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	std::function<void(size_t, size_t)> job;
+	std::exception_ptr error;
+	std::atomic<size_t> pending{0};
+	uint64_t generation = 0;
+	bool stop = false;
+
+	bool take(unsigned id, std::pair<size_t, size_t> &range)
+	{
+		{
+			Queue &own = *queues[id];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.ranges.empty())
+			{
+				range = own.ranges.front();
+				own.ranges.pop_front();
+				return true;
+			}
+		}
+		for (size_t step = 1; step < queues.size(); step++)
+		{
+			Queue &victim = *queues[(id + step) % queues.size()];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.ranges.empty())
+			{
+				range = victim.ranges.back();
+				victim.ranges.pop_back();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void work(unsigned id)
+	{
+		std::pair<size_t, size_t> range;
+		while (take(id, range))
+		{
+			try
+			{
+				job(range.first, range.second);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!error)
+					error = std::current_exception();
+			}
+
+			if (pending.fetch_sub(1) == 1)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				done.notify_all();
+			}
+		}
+	}
+
+	void run(unsigned id)
+	{
+		uint64_t seen = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&] { return stop || generation != seen; });
+				if (stop)
+					return;
+				seen = generation;
+			}
+			work(id);
+		}
+	}
+};
+
+} // namespace cwparser
@@ -0,0 +1,157 @@
+#include "cwparser/cwparser.hpp"
+#include "test_framework.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <vector>
+
+// Every allocation of the process goes through here. Kept out of line: once inlined, GCC pairs the
+// malloc and free inside with the new and delete expressions and warns -Wmismatched-new-delete
+static std::atomic<size_t> allocations{0};
+
+[[gnu::noinline]] void* operator new(std::size_t size) {
+    allocations++;
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+[[gnu::noinline]] void operator delete(void* ptr) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete[](void* ptr) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+// Allocations made by body
+template <typename Body>
+size_t countAllocations(Body&& body) {
+    size_t before = allocations.load();
+    body();
+    return allocations.load() - before;
+}
+
+// Budgets for the hot paths, raise one only with a reason
+class cwparser_alloc_test {
+public:
+    const std::string test_file = "test_config_alloc.txt";
+    static constexpr size_t sections = 50;
+    static constexpr size_t properties_per_section = 20;
+
+    void setUp() {
+        std::ofstream out(test_file);
+        for (size_t s = 0; s < sections; s++) {
+            out << "[section" << s << "]\n";
+            for (size_t p = 0; p < properties_per_section; p++)
+                out << "    key" << p << ": " << s * 100 + p << "\n";
+            out << "    [child]\n        port: 8080\n";
+        }
+    }
+
+    void tearDown() {
+        std::remove(test_file.c_str());
+    }
+
+    bool report(const char* what, size_t count, size_t budget) {
+        std::cout << "  " << what << ": " << count << " allocations, budget " << budget << std::endl;
+        return count <= budget;
+    }
+
+    bool testLookupAllocations() {
+        setUp();
+        bool success = true;
+
+        cwparser::cwparser parser;
+        success &= parser.parse(test_file);
+        cwparser::Node& node = parser["section7"];
+        constexpr cwparser::Key key{"key3"};
+        int sum = 0;
+
+        success &= report("Node::get<int>", countAllocations([&] {
+            for (int i = 0; i < 1000; i++)
+                sum += *node.get<int>("key3");
+        }), 0);
+        success &= report("Node::try_get<int>", countAllocations([&] {
+            for (int i = 0; i < 1000; i++)
+                sum += *node.try_get<int>(key);
+        }), 0);
+        success &= report("Node::get<bool>", countAllocations([&] {
+            for (int i = 0; i < 1000; i++)
+                sum += node["child"].get<bool>("missing").has_value();
+        }), 0);
+
+        cwparser::Frozen frozen = parser.freeze();
+        success &= report("FrozenNode::get<int>", countAllocations([&] {
+            for (int i = 0; i < 1000; i++)
+                sum += *frozen["section7"].get<int>(key) + *frozen["section7"]["child"].get<int>("port");
+        }), 0);
+
+        success &= sum == 1000 * (703 + 703 + 703 + 8080);
+        tearDown();
+        return success;
+    }
+
+    bool testParseAllocations() {
+        setUp();
+        bool success = true;
+
+        // First parse interns the names, the second one measures the steady state
+        auto interner = std::make_shared<cwparser::Interner>();
+        cwparser::cwparser warm(interner);
+        success &= warm.parse(test_file);
+
+        cwparser::cwparser parser(interner);
+        const size_t properties = sections * (properties_per_section + 1);
+        const size_t nodes = 2 * sections;
+        size_t count = countAllocations([&] { success &= parser.parse(test_file); });
+        // One map node per property, each section its node and its entry in the parent's children map,
+        // and per file the stream, the tree state and the read window (11 measured with libstdc++)
+        success &= report("parse()", count, properties + 2 * nodes + 16);
+
+        tearDown();
+        return success;
+    }
+
+    bool testScanAllocations() {
+        setUp();
+        bool success = true;
+
+        struct Sum : cwparser::Handler {
+            size_t properties = 0;
+            void on_property(std::string_view, std::string_view, cwparser::Location) { properties++; }
+        } handler;
+
+        // Independent from the file size: the read window, the stream and the section stack (4 measured)
+        size_t count = countAllocations([&] { success &= cwparser::cwparser::scan(test_file, handler); });
+        success &= handler.properties == sections * (properties_per_section + 1);
+        success &= report("scan()", count, 6);
+
+        tearDown();
+        return success;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    TestFramework framework;
+    cwparser_alloc_test tests;
+
+    std::string test_name;
+    bool all = argc < 2;
+    if (!all)
+        test_name = argv[1];
+
+    if( test_name == "lookup_allocations" || all )
+    { framework.addTest("lookup_allocations", std::bind(&cwparser_alloc_test::testLookupAllocations, &tests)); };
+    if( test_name == "parse_allocations" || all )
+    { framework.addTest("parse_allocations", std::bind(&cwparser_alloc_test::testParseAllocations, &tests)); };
+    if( test_name == "scan_allocations" || all )
+    { framework.addTest("scan_allocations", std::bind(&cwparser_alloc_test::testScanAllocations, &tests)); };
+
+    return framework.runTests() ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+// Parse time and peak memory on generated configurations, not run by ctest:
+//
+//   cwparser_bench sections [count]   count sections of nine keys, 100000 by default
+//   cwparser_bench flat [count]       one section holding count keys, 1000000 by default
+//   cwparser_bench pooled [count]     the flat file parsed on a ThreadPool
+//
+// Run one case per process, the peak resident size covers the whole run.
+#include "cwparser/cwparser.hpp"
+#include "cwparser/bulk.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+
+static std::string generate(const std::string& layout, size_t count) {
+    std::string file = "cwparser_bench_" + layout + ".cfg";
+    std::ofstream out(file);
+    if (layout == "sections") {
+        for (size_t idx = 0; idx < count; idx++) {
+            out << "[device" << idx << "]\n    host: node" << idx % 64 << ".local\n    port: " << 8000 + idx % 100
+                << "\n    rate: 100\n    enabled: true\n    ratio: 0.75\n    mode: default\n"
+                << "    table: [1, 2, 3, 4]\n    name: \"device " << idx << "\"\n    timeout: 30\n";
+        }
+    } else {
+        out << "[generated]\n";
+        for (size_t idx = 0; idx < count; idx++)
+            out << "    key" << idx << ": " << idx << "\n";
+    }
+    return file;
+}
+
+int main(int argc, char* argv[]) {
+    std::string layout = argc > 1 ? argv[1] : "sections";
+    size_t count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : (layout == "sections" ? 100000 : 1000000);
+    if (layout != "sections" && layout != "flat" && layout != "pooled") {
+        std::cerr << "usage: cwparser_bench sections|flat|pooled [count]" << std::endl;
+        return 2;
+    }
+    std::string file = generate(layout == "pooled" ? "flat" : layout, count);
+
+    cwparser::cwparser parser;
+    auto start = std::chrono::steady_clock::now();
+    bool parsed;
+    if (layout == "pooled") {
+        cwparser::ThreadPool pool;
+        std::ifstream in(file, std::ios::binary);
+        parsed = parser.parse(in, pool);
+    } else {
+        parsed = parser.parse(file);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::remove(file.c_str());
+
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    std::cout << layout << " " << count << ": parse " << seconds << " s, peak RSS " << usage.ru_maxrss / 1024.0
+              << " MB" << std::endl;
+    return parsed ? 0 : 1;
+}
@@ -0,0 +1,79 @@
+#include "test_framework.hpp"
+#include "sample_config.hpp"
+#include <sstream>
+
+class cwparser_codegen_test {
+public:
+    bool testGeneratedLoader() {
+        bool success = true;
+
+        std::istringstream in(R"(
+[system]
+    threads: 16
+    debug_mode: off
+    ratio: 2.25
+    hex_value: 0x10
+    name: "edge node"
+    unknown_key: 1
+
+[graphics]
+    resolution: [3840, 2160]
+    weights: [1, 2.5, -3]
+
+[extra]
+    port: 1
+    [nested]
+        port: 2
+
+[network]
+    [server]
+        host: example.org
+        port: 443
+    [client]
+        port: 8443
+        retry: no
+)");
+
+        sample::Config config;
+        size_t bad_line = 0;
+        success &= sample::load(in, config, &bad_line) && bad_line == 0;
+        success &= config.system.threads == 16 && !config.system.debug_mode && config.system.ratio == 2.25;
+        success &= config.system.hex_value == 16 && config.system.name == "edge node";
+        success &= config.graphics.resolution == std::vector<long>{3840, 2160};
+        success &= config.graphics.weights == std::vector<double>{1, 2.5, -3};
+        success &= config.network.server.host == "example.org" && config.network.server.port == 443;
+        success &= config.network.client.port == 8443 && !config.network.client.retry;
+
+        std::istringstream names("[limits]\n    max-rate: 3\n    max_rate: 0.25\n    and: 4\n    constexpr: 5\n"
+                                 "    port: 6\n    [port]\n        value: 8\n");
+        success &= sample::load(names, config);
+        success &= config.limits.max_rate == 3 && config.limits.max_rate_2 == 0.25;
+        success &= config.limits.and_ == 4 && config.limits.constexpr_ == 5;
+        success &= config.limits.port.value == 8 && config.limits.port_2 == 6;
+
+        // Tabs count as four columns, as in cwparser::parse
+        std::istringstream tabs("[network]\n\t[server]\n\t\tport: 7\n\t[client]\n\t\tport: 8\n");
+        success &= sample::load(tabs, config);
+        success &= config.network.server.port == 7 && config.network.client.port == 8;
+
+        std::istringstream bad("[network]\n    [server]\n        port: eighty\n");
+        success &= !sample::load(bad, config, &bad_line) && bad_line == 3;
+
+        return success;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    TestFramework framework;
+    cwparser_codegen_test tests;
+
+    std::string test_name;
+    bool all = argc < 2;
+    if (!all)
+        test_name = argv[1];
+
+    if( test_name == "generated_loader" || all )
+    { framework.addTest("generated_loader", std::bind(&cwparser_codegen_test::testGeneratedLoader, &tests)); };
+
+    return framework.runTests() ? 0 : 1;
+}
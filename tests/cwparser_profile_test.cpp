@@ -0,0 +1,82 @@
+#include "cwparser/cwparser.hpp"
+#include "cwparser/profile.hpp"
+#include "test_framework.hpp"
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+
+// Built with CWPARSER_PROFILE, see CMakeLists.txt; the other suites run without the hooks
+class cwparser_profile_test {
+public:
+    const std::string test_file = "test_config_profile.txt";
+
+    void setUp() {
+        std::ofstream out(test_file);
+        out << "[network]\n    [server]\n        host: localhost\n        port: 8080\n";
+    }
+
+    void tearDown() {
+        std::remove(test_file.c_str());
+    }
+
+    bool testAccessProfiling() {
+        setUp();
+        bool success = true;
+
+        cwparser::cwparser parser;
+        success &= parser.parse(test_file);
+        cwparser::Profiler::reset();
+        cwparser::Node& server = parser["network"]["server"];
+        for (int i = 0; i < 5; i++)
+            success &= server.get<int>("port").value() == 8080;
+        for (int i = 0; i < 2; i++)
+            success &= server.try_get<std::string>("host").has_value();
+        success &= !server.get<int>("missing").has_value();
+
+        auto entries = cwparser::Profiler::entries();
+        auto find = [&](const std::string& path, const std::string& type) -> const cwparser::ProfileEntry* {
+            for (const auto& entry : entries)
+                if (entry.path == path && entry.type == type)
+                    return &entry;
+            return nullptr;
+        };
+        const cwparser::ProfileEntry* port = find("network.server.port", "int");
+        // Demangled where the compiler allows it
+        const cwparser::ProfileEntry* host = find("network.server.host", cwparser::Profiler::typeName(typeid(std::string)));
+        const cwparser::ProfileEntry* missing = find("network.server.missing", "int");
+        success &= port != nullptr && port->calls == 5;
+        success &= host != nullptr && host->calls == 2;
+        success &= missing != nullptr && missing->calls == 1 && missing->convert_ns == 0;
+        success &= find("network.server", "section") != nullptr;
+        success &= !entries.empty() && entries.front().calls >= 5;
+        for (size_t i = 1; i < entries.size(); i++)
+            success &= entries[i - 1].calls >= entries[i].calls;
+
+        std::ostringstream report;
+        cwparser::Profiler::report(report);
+        success &= report.str().find("network.server.port") != std::string::npos;
+
+        cwparser::Profiler::reset();
+        success &= cwparser::Profiler::entries().empty();
+
+        tearDown();
+        return success;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    TestFramework framework;
+    cwparser_profile_test tests;
+
+    std::string test_name;
+    bool all = argc < 2;
+    if (!all)
+        test_name = argv[1];
+
+    if( test_name == "access_profiling" || all )
+    { framework.addTest("access_profiling", std::bind(&cwparser_profile_test::testAccessProfiling, &tests)); };
+
+    return framework.runTests() ? 0 : 1;
+}
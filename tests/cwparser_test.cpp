@@ -1,57 +1,54 @@
 #include "cwparser/cwparser.hpp"
+#include "cwparser/bulk.hpp"
+#include "cwparser/diff.hpp"
+#include "cwparser/loader.hpp"
+#include "cwparser/schema.hpp"
+#include "cwparser/shared.hpp"
+#include "test_framework.hpp"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
 #include <fstream>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <functional>
+#include <random>
+#include <sstream>
+#include <thread>
 #include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
 
-// Simple test framework
-class TestFramework {
-private:
-    struct TestCase {
-        std::string name;
-        std::function<bool()> test;
-    };
-    std::vector<TestCase> tests;
-    int passed = 0;
-    int failed = 0;
-
-    void printResult(const std::string& name, bool success) {
-        if (success) {
-            std::cout << "\033[32m[PASS]\033[0m " << name << std::endl;
-            passed++;
-        } else {
-            std::cout << "\033[31m[FAIL]\033[0m " << name << std::endl;
-            failed++;
-        }
-    }
+// Test fixture class
+enum class Mode { fast, safe, debug };
 
-public:
-    void addTest(const std::string& name, std::function<bool()> test) {
-        tests.push_back({name, test});
-    }
-
-    bool runTests() {
-        for (const auto& test : tests) {
-            try {
-                bool result = test.test();
-                printResult(test.name, result);
-            } catch (const std::exception& e) {
-                std::cout << "\033[31m[EXCEPTION]\033[0m in " << test.name << ": " << e.what() << std::endl;
-                failed++;
-            }
-        }
-        
-        std::cout << "\nTest Summary:\n";
-        std::cout << "Passed: " << passed << "\n";
-        std::cout << "Failed: " << failed << "\n";
-        std::cout << "Total:  " << tests.size() << "\n";
-        
-        return failed == 0;
-    }
+template <>
+struct cwparser::enum_names<Mode> {
+    static constexpr std::pair<std::string_view, Mode> values[] = {
+        {"fast", Mode::fast}, {"safe", Mode::safe}, {"debug", Mode::debug}};
+};
+
+// Large enough that a single seed never gives a collision-free table
+#define REGISTERS(X) \
+    X(r0) X(r1) X(r2) X(r3) X(r4) X(r5) X(r6) X(r7) X(r8) X(r9) X(r10) X(r11) \
+    X(r12) X(r13) X(r14) X(r15) X(r16) X(r17) X(r18) X(r19) X(r20) X(r21) X(r22) X(r23) \
+    X(r24) X(r25) X(r26) X(r27) X(r28) X(r29) X(r30) X(r31) X(r32) X(r33) X(r34) X(r35) \
+    X(r36) X(r37) X(r38) X(r39) X(r40) X(r41) X(r42) X(r43) X(r44) X(r45) X(r46) X(r47) \
+    X(r48) X(r49) X(r50) X(r51) X(r52) X(r53) X(r54) X(r55) X(r56) X(r57) X(r58) X(r59) \
+    X(r60) X(r61) X(r62) X(r63) X(r64) X(r65) X(r66) X(r67) X(r68) X(r69) X(r70) X(r71) \
+    X(r72) X(r73) X(r74) X(r75) X(r76) X(r77) X(r78) X(r79) X(r80) X(r81) X(r82) X(r83) \
+    X(r84) X(r85) X(r86) X(r87) X(r88) X(r89) X(r90) X(r91) X(r92) X(r93) X(r94) X(r95)
+
+#define REGISTER_ENUMERATOR(name) name,
+#define REGISTER_ENTRY(name) {#name, Register::name},
+enum class Register { REGISTERS(REGISTER_ENUMERATOR) };
+
+template <>
+struct cwparser::enum_names<Register> {
+    static constexpr std::pair<std::string_view, Register> values[] = {REGISTERS(REGISTER_ENTRY)};
 };
 
-// Test fixture class
 class cwparser_test {
 protected:
     cwparser::cwparser parser;
@@ -93,6 +90,16 @@ protected:
 [malformed]
     empty: [[]]
     missingbr: [[1,2,3][1,3]
+
+[sensors]
+    [front]
+        rate: 100
+        thread_count: 2
+    [rear]
+        rate: 50
+        thread_pool: 4
+    [aux]
+        gain: 3
 )";
         std::ofstream config_file(test_file);
         config_file << config_content;
@@ -270,6 +277,975 @@ public:
         tearDown();
         return success;
     }
+
+    bool testNonThrowingAccess() {
+        setUp();
+        bool success = true;
+
+        success &= parser.parse(test_file);
+        auto threads = parser["system"].try_get<int>("threads");
+        success &= threads.has_value() && *threads == 4;
+
+        auto missing = parser["system"].try_get<int>("nonexistent");
+        success &= !missing && missing.error().code == cwparser::ErrorCode::missing_key;
+
+        auto flag = parser["system"].try_get<int>("debug_mode");
+        success &= !flag && flag.error().code == cwparser::ErrorCode::invalid_value &&
+                  flag.error().line == 5 && flag.error().column == 17;
+
+        auto broken = parser["malformed"].try_get<std::vector<int>>("missingbr");
+        success &= !broken && broken.error().code == cwparser::ErrorCode::invalid_value &&
+                  broken.error().line == 35 && broken.error().column == 17;
+
+        auto big = parser["types_test"].try_get<std::vector<double>>("vector_nums");
+        success &= big.has_value() && big->size() == 4 && (*big)[3] == 4.0;
+
+        tearDown();
+        return success;
+    }
+
+    bool testKeyInterning() {
+        setUp();
+        bool success = true;
+
+        auto shared = std::make_shared<cwparser::Interner>();
+        cwparser::cwparser first(shared), second(shared);
+        success &= first.parse(test_file) && second.parse(test_file);
+
+        auto& server = first["network"]["server"];
+        auto& other = second["network"]["server"];
+        success &= bool(server) && bool(other);
+        success &= server.properties.begin()->first == other.properties.begin()->first;
+        success &= &server.properties.begin()->first.str() == &other.properties.begin()->first.str();
+
+        size_t distinct = shared->size();
+        success &= second.parse(test_file) && shared->size() == distinct;
+        success &= shared->find("max_connections") && !shared->find("not_a_key");
+
+        server.setValue("port", "9090");
+        server.setValue("timeout", "30");
+        success &= *server.get<int>("port") == 9090 && *server.get<int>("timeout") == 30;
+        success &= server.properties.size() == 4;
+
+        tearDown();
+        return success;
+    }
+
+    bool testPrecomputedKeys() {
+        setUp();
+        bool success = true;
+
+        static constexpr cwparser::Key network{"network"};
+        static constexpr cwparser::Key server{"server"};
+        static constexpr cwparser::Key port{"port"};
+        static_assert(port.hash == cwparser::_::hash("port"), "hash must be computed at compile time");
+
+        success &= parser.parse(test_file);
+        auto value = parser[network][server].get<int>(port);
+        success &= value.has_value() && *value == 8080;
+
+        std::string_view host_view = "host";
+        std::string host_string = "host";
+        success &= *parser[network][server].get<std::string>(host_view) == "localhost";
+        success &= *parser["network"]["server"].get<std::string>(host_string) == "localhost";
+        success &= parser[network][server].try_get<int>(cwparser::Key("max_connections")).has_value();
+        success &= !parser[network].child(port);
+
+        tearDown();
+        return success;
+    }
+
+    bool testWildcardQueries() {
+        setUp();
+        bool success = true;
+
+        success &= parser.parse(test_file);
+
+        int total = 0;
+        std::vector<std::string> paths;
+        auto rates = parser.select("sensors.*.rate");
+        for (auto it = rates.begin(); it != rates.end(); ++it) {
+            total += *it->get<int>();
+            paths.push_back(it.path());
+        }
+        success &= total == 150 && paths.size() == 2 &&
+                  paths[0] == "sensors.front.rate" && paths[1] == "sensors.rear.rate";
+
+        size_t threads = 0;
+        for (const auto& match : parser.select("sensors.*.thread_*"))
+            threads += match.key.str().rfind("thread_", 0) == 0;
+        success &= threads == 2;
+
+        size_t ports = 0;
+        for (const auto& match : parser.select("**.port"))
+            ports += *match.get<int>() == 8080;
+        success &= ports == 1;
+
+        size_t below = 0;
+        for (const auto& match : parser.select("sensors.**")) { (void)match; below++; }
+        success &= below == 5;
+
+        size_t server = 0;
+        for (const auto& match : parser["network"].select("server.?o*")) { (void)match; server++; }
+        success &= server == 2;
+
+        success &= parser.select("nothing.*.rate").begin() == parser.select("nothing.*.rate").end();
+
+        // Parsing sorts nothing, threads racing to the first query of a fresh tree share one index
+        cwparser::cwparser fresh;
+        success &= fresh.parse(test_file);
+        std::atomic<size_t> matched{0};
+        std::vector<std::thread> workers;
+        for (int idx = 0; idx < 4; idx++) {
+            workers.emplace_back([&] {
+                for (const auto& match : fresh.select("**.rate")) { (void)match; matched++; }
+            });
+        }
+        for (auto& worker : workers)
+            worker.join();
+        success &= matched.load() == 8;
+        const auto& index = fresh["sensors"].keyIndex();
+        success &= &index == &fresh["sensors"].keyIndex() && index.children.size() == 3;
+
+        tearDown();
+        return success;
+    }
+
+    bool testFrozenLookups() {
+        setUp();
+        bool success = true;
+
+        cwparser::Frozen frozen;
+        {
+            cwparser::cwparser local;
+            success &= local.parse(test_file);
+            frozen = local.freeze();
+        }
+
+        auto port = frozen["network"]["server"].get<int>("port");
+        success &= port.has_value() && *port == 8080;
+
+        auto vec = frozen["types_test"].get<std::vector<double>>("vector_nums");
+        success &= vec.has_value() && vec->size() == 4;
+
+        auto tuple = frozen["types_test"].get<std::tuple<int, double, std::string>>("tuple_value");
+        success &= tuple.has_value() && std::get<2>(*tuple) == "hello";
+
+        success &= !frozen["network"]["nonexistent"];
+        success &= !frozen["system"].get<int>("nonexistent").has_value();
+
+        auto flag = frozen["system"].try_get<int>("debug_mode");
+        success &= !flag && flag.error().line == 5 && flag.error().column == 17;
+
+        size_t sections = frozen.root().bytes();
+        success &= sections > 0 && sections < frozen.bytes();
+        success &= frozen["sensors"].bytes() > frozen["sensors"]["front"].bytes() + frozen["sensors"]["rear"].bytes();
+        success &= frozen["sensors"]["aux"].name() == "aux" && frozen["sensors"].childCount() == 3;
+
+        tearDown();
+        return success;
+    }
+
+    bool testParallelBulkConversion() {
+        setUp();
+        bool success = true;
+
+        success &= parser.parse(test_file);
+        cwparser::ThreadPool pool(4);
+
+        auto items = cwparser::collect(parser.select("sensors.**"));
+        std::vector<int> values(items.size());
+        success &= cwparser::convertParallel(items, values.data(), pool) == 0;
+        int total = 0;
+        for (int value : values) total += value;
+        success &= items.size() == 5 && total == 159;
+
+        using Point3D = std::tuple<int, int, int>;
+        std::vector<const cwparser::Node*> nodes{&parser["coordinates"], &parser["system"]};
+        auto mixed = cwparser::collect(nodes);
+        std::vector<Point3D> points(mixed.size());
+        std::vector<cwparser::Error> errors(mixed.size());
+        size_t failed = cwparser::convertParallel(mixed, points.data(), pool, errors.data());
+        success &= mixed.size() == 6 && failed == 4;
+        success &= errors[0].code == cwparser::ErrorCode::ok && std::get<2>(points[0]) == 300;
+        success &= errors[2].code != cwparser::ErrorCode::ok && errors[2].line != 0;
+
+        std::vector<size_t> squares(10000);
+        pool.parallelFor(squares.size(), [&](size_t begin, size_t end) {
+            for (size_t idx = begin; idx < end; idx++) squares[idx] = idx * idx;
+        }, 7);
+        success &= squares[9999] == 9999u * 9999u && squares[1234] == 1234u * 1234u;
+
+        tearDown();
+        return success;
+    }
+
+    bool testBracketedTupleParsing() {
+        setUp();
+        bool success = true;
+
+        success &= parser.parse(test_file);
+        auto& coords = parser["coordinates"];
+        coords.setValue("bracketed", "[1, 3.14, \"hello, world\"]");
+        coords.setValue("nested", "[[1, 2], 7]");
+        coords.setValue("spaced_vector", "[1,2] 7");
+        coords.setValue("short", "[1, 2]");
+
+        using MixedTuple = std::tuple<int, double, std::string>;
+        auto bracketed = coords.get<MixedTuple>("bracketed");
+        success &= bracketed.has_value() && std::get<0>(*bracketed) == 1 &&
+                  std::get<1>(*bracketed) == 3.14 && std::get<2>(*bracketed) == "hello, world";
+
+        using VectorTuple = std::tuple<std::vector<int>, int>;
+        auto nested = coords.get<VectorTuple>("nested");
+        success &= nested.has_value() && std::get<0>(*nested).size() == 2 && std::get<1>(*nested) == 7;
+        auto spaced = coords.get<VectorTuple>("spaced_vector");
+        success &= spaced.has_value() && std::get<0>(*spaced)[1] == 2 && std::get<1>(*spaced) == 7;
+
+        auto short_tuple = coords.try_get<std::tuple<int, int, int>>("short");
+        success &= !short_tuple && short_tuple.error().code == cwparser::ErrorCode::bad_format;
+
+        auto point = coords.get<std::tuple<int, int, int>>("point2");
+        success &= point.has_value() && std::get<0>(*point) == 150 && std::get<2>(*point) == 350;
+
+        tearDown();
+        return success;
+    }
+
+    bool testSubtreeDiff() {
+        setUp();
+        bool success = true;
+
+        const std::string reload_file = "test_config_reload.txt";
+        std::ofstream reload(reload_file);
+        reload << R"(
+[network]
+    [server]
+        max_connections: 100
+        port: 9090
+        host: localhost
+        timeout: 30
+[sensors]
+    [rear]
+        thread_pool: 4
+        rate: 50
+    [front]
+        rate: 100
+        thread_count: 2
+[extra]
+    key: value
+)";
+        reload.close();
+
+        cwparser::cwparser before, after;
+        success &= before.parse(test_file) && after.parse(reload_file);
+        std::remove(reload_file.c_str());
+
+        success &= before["sensors"]["front"].fingerprint() == after["sensors"]["front"].fingerprint();
+        success &= before["sensors"].fingerprint() != after["sensors"].fingerprint();
+
+        auto changes = cwparser::diff(before, after);
+        std::vector<std::string> added, removed, changed;
+        for (const auto& change : changes) {
+            if (change.kind == cwparser::Change::Kind::added) added.push_back(change.path);
+            if (change.kind == cwparser::Change::Kind::removed) removed.push_back(change.path);
+            if (change.kind == cwparser::Change::Kind::changed) changed.push_back(change.path);
+        }
+        success &= added == std::vector<std::string>{"extra", "network.server.timeout"};
+        success &= changed == std::vector<std::string>{"network.server.port"};
+        success &= removed.size() == 6 && removed[5] == "types_test" && removed[4] == "system" && removed[3] == "sensors.aux";
+
+        after["network"]["server"].setValue("port", "8080");
+        after["network"]["server"].setValue("timeout", "");
+        after.getRoot().refreshFingerprint();
+        success &= cwparser::diff(before["network"], after["network"]).size() == 1;
+
+        tearDown();
+        return success;
+    }
+
+    struct CountingHandler : cwparser::Handler {
+        size_t begins = 0, ends = 0, properties = 0, max_depth = 0;
+        std::string last_key, last_value, server_parent;
+        std::vector<std::string> open;
+        cwparser::Location port_location;
+
+        void on_section_begin(std::string_view name, size_t depth) {
+            begins++;
+            max_depth = std::max(max_depth, depth);
+            open.resize(depth);
+            if (name == "server") server_parent = open.back();
+            open.emplace_back(name);
+        }
+        void on_property(std::string_view key, std::string_view value, cwparser::Location location) {
+            properties++;
+            last_key = std::string(key);
+            last_value = std::string(value);
+            if (key == "port") port_location = location;
+        }
+        void on_section_end(std::string_view, size_t) { ends++; }
+    };
+
+    bool testStreamingScan() {
+        setUp();
+        bool success = true;
+
+        CountingHandler handler;
+        success &= cwparser::cwparser::scan(test_file, handler, 16);
+        success &= handler.begins == 11 && handler.ends == 11 && handler.properties == 27;
+        success &= handler.max_depth == 1 && handler.server_parent == "network";
+        success &= handler.last_key == "gain" && handler.last_value == "3";
+        success &= handler.port_location.line == 16 && handler.port_location.column == 11;
+
+        std::istringstream no_newline("[a]\n    k: v");
+        CountingHandler tail;
+        success &= cwparser::cwparser::scan(no_newline, tail) && tail.properties == 1 && tail.last_value == "v";
+
+        success &= !cwparser::cwparser::scan("nonexistent_file.txt", handler);
+
+        tearDown();
+        return success;
+    }
+
+    bool testCopyOnWrite() {
+        setUp();
+        bool success = true;
+
+        cwparser::cwparser base;
+        success &= base.parse(test_file);
+        uint64_t base_fingerprint = base.getRoot().fingerprint();
+
+        auto tuned = base.with_value("network.server.port", "9090");
+        success &= base["network"]["server"].get<int>("port").value() == 8080;
+        success &= tuned["network"]["server"].get<int>("port").value() == 9090;
+        success &= &tuned["sensors"] == &base["sensors"] && &tuned["system"] == &base["system"];
+        success &= &tuned["network"] != &base["network"];
+        success &= base.getRoot().fingerprint() == base_fingerprint;
+
+        auto changes = cwparser::diff(base, tuned);
+        success &= changes.size() == 1 && changes[0].path == "network.server.port";
+
+        auto batch = base.with_values({{"sensors.front.rate", "1"},
+                                       {"sensors.rear.rate", "2"},
+                                       {"sensors.front.rate", "3"},
+                                       {"extra.level", "high"}});
+        success &= batch["sensors"]["front"].get<int>("rate").value() == 3;
+        success &= batch["sensors"]["rear"].get<int>("rate").value() == 2;
+        success &= &batch["sensors"]["aux"] == &base["sensors"]["aux"];
+        success &= batch["extra"].get<std::string>("level").value() == "high";
+        success &= !base.getRoot().child("extra");
+        success &= batch.select("sensors.*.rate").begin() != batch.select("sensors.*.rate").end();
+
+        // Rebuilding from scratch must agree with the incrementally maintained fingerprints
+        uint64_t incremental = batch.getRoot().fingerprint();
+        success &= batch.getRoot().refreshFingerprint() == incremental;
+        success &= cwparser::diff(base, batch).size() == 3;
+
+        tearDown();
+        return success;
+    }
+
+    bool testEnumAndBoolParsing() {
+        setUp();
+        bool success = true;
+
+        success &= parser.parse(test_file);
+        success &= parser["system"].get<bool>("debug_mode").value();
+        success &= parser["graphics"].get<bool>("vsync").value();
+
+        cwparser::Node node;
+        const char* yes[] = {"true", "Yes", "ON", " 1 "};
+        const char* no[] = {"false", "NO", "off", "0"};
+        for (const char* text : yes) {
+            node.setValue("flag", text);
+            success &= node.try_get<bool>("flag").value() == true;
+        }
+        for (const char* text : no) {
+            node.setValue("flag", text);
+            success &= node.try_get<bool>("flag").value() == false;
+        }
+        node.setValue("flag", "maybe");
+        success &= node.try_get<bool>("flag").error().code == cwparser::ErrorCode::invalid_value;
+
+        node.setValue("mode", " safe");
+        success &= node.get<Mode>("mode").value() == Mode::safe;
+        node.setValue("mode", "debug");
+        success &= node.try_get<Mode>("mode").value() == Mode::debug;
+        node.setValue("mode", "turbo");
+        success &= !node.try_get<Mode>("mode");
+        node.setValue("modes", "[fast, debug]");
+        success &= node.get<std::vector<Mode>>("modes").value() == std::vector<Mode>{Mode::fast, Mode::debug};
+
+        for (const auto& entry : cwparser::enum_names<Register>::values) {
+            node.setValue("register", std::string(entry.first));
+            success &= node.get<Register>("register").value() == entry.second;
+        }
+        node.setValue("register", "r96");
+        success &= !node.try_get<Register>("register");
+
+        tearDown();
+        return success;
+    }
+
+    bool testReferenceInterpolation() {
+        bool success = true;
+
+        const std::string file = "test_config_refs.txt";
+        std::ofstream out(file);
+        out << R"(
+[paths]
+    base: /opt/app
+    logs: ${paths.base}/logs
+    archive: ${paths.logs}/old
+[network]
+    [server]
+        port: 8080
+[client]
+    port: ${network.server.port}
+    url: http://localhost:${ network.server.port }/api
+    broken: ${missing.key}
+    loop_a: ${client.loop_b}
+    loop_b: ${client.loop_a}
+    unterminated: ${paths.base
+)";
+        out.close();
+
+        cwparser::cwparser parser;
+        success &= parser.parse(file);
+        std::remove(file.c_str());
+
+        auto& paths = parser["paths"];
+        auto& client = parser["client"];
+        success &= paths.get<std::string>("archive").value() == "/opt/app/logs/old";
+        success &= paths.get<std::string>("logs").value() == "/opt/app/logs";
+        success &= client.get<int>("port").value() == 8080;
+        success &= client.get<std::string>("url").value() == "http://localhost:8080/api";
+        success &= client.get<std::string>("unterminated").value() == "${paths.base";
+
+        auto broken = client.try_get<std::string>("broken");
+        success &= !broken && broken.error().code == cwparser::ErrorCode::missing_key && broken.error().line == 12;
+        success &= client.try_get<std::string>("loop_a").error().code == cwparser::ErrorCode::reference_cycle;
+
+        // Raw text is kept, expansion happens on read and follows later edits
+        success &= client.properties.find(cwparser::Key("port"))->second.text() == "${network.server.port}";
+        parser["network"]["server"].setValue("port", "9090");
+        success &= client.get<int>("port").value() == 9090;
+
+        auto tuned = parser.with_value("network.server.port", "7070");
+        success &= tuned["client"].get<int>("port").value() == 7070;
+        success &= tuned["paths"].get<std::string>("logs").value() == "/opt/app/logs";
+        success &= &tuned["paths"] != &parser["paths"];
+        success &= parser["client"].get<int>("port").value() == 9090;
+
+        // Keys whose reference target changed count as changed, unresolvable ones compare by error
+        std::vector<std::string> changed;
+        for (const auto& change : cwparser::diff(parser, tuned))
+            changed.push_back(change.path);
+        success &= changed == std::vector<std::string>{"client.port", "client.url", "network.server.port"};
+        success &= parser.freeze()["client"].get<int>("port").value() == 9090;
+
+        // Every edit drops the memoized expansions: replacing a section, bulk stores and sharing
+        std::istringstream small("[a]\n    x: 1\n    [b]\n        y: 2\n[c]\n    r: ${a.b.y}\n[d]\n    [b]\n        y: 2\n");
+        cwparser::cwparser edited;
+        success &= edited.parse(small) && edited["c"].get<int>("r").value() == 2;
+        auto replacement = std::make_shared<cwparser::Node>(edited.getInterner());
+        replacement->setValue("y", "42");
+        edited["a"].setChild("b", replacement);
+        success &= edited["c"].get<int>("r").value() == 42 && edited["a"]["b"].get<int>("y").value() == 42;
+
+        cwparser::ThreadPool pool(2);
+        std::vector<cwparser::_::Pending> batch{{"y", "43", {}}};
+        replacement->setValues(batch, pool);
+        success &= edited["c"].get<int>("r").value() == 43;
+        auto fresh = std::make_shared<cwparser::Node>(edited.getInterner());
+        std::vector<cwparser::_::Pending> bulk{{"y", "44", {}}, {"z", "${a.x}", {}}};
+        fresh->setValues(bulk, pool, false, 1);
+        edited["a"].setChild("b", fresh);
+        success &= edited["c"].get<int>("r").value() == 44 && edited["a"]["b"].get<int>("z").value() == 1;
+
+        edited["a"].setChild("b", std::make_shared<cwparser::Node>(edited.getInterner()));
+        edited["a"]["b"].setValue("y", "2");
+        success &= edited["c"].get<int>("r").value() == 2;
+        success &= edited.deduplicate() == 1 && edited["c"].get<int>("r").value() == 2;
+
+        return success;
+    }
+
+    bool testBatchLoading() {
+        bool success = true;
+
+        namespace fs = std::filesystem;
+        const fs::path dir = "test_configs_batch";
+        fs::remove_all(dir);
+        fs::create_directory(dir);
+        for (int idx = 0; idx < 40; idx++) {
+            std::ofstream out(dir / ("device" + std::to_string(idx) + ".cfg"));
+            out << "[device]\n    id: " << idx << "\n    [link]\n        port: " << 8000 + idx << "\n";
+        }
+        std::ofstream(dir / "notes.txt") << "[ignored]\n    key: value\n";
+
+        cwparser::ThreadPool pool(4);
+        auto interner = std::make_shared<cwparser::Interner>();
+        std::vector<std::string> failed;
+        auto configs = cwparser::loadDirectory(dir.string(), pool, ".cfg", interner, &failed);
+        success &= configs.size() == 40 && failed.empty();
+
+        auto& seven = configs.at((dir / "device7.cfg").string());
+        success &= seven["device"].get<int>("id").value() == 7;
+        success &= seven["device"]["link"].get<int>("port").value() == 8007;
+        // Names common to every file are interned once
+        success &= interner->size() == 4 && seven.getInterner() == interner;
+
+        auto some = cwparser::loadFiles({(dir / "device1.cfg").string(), (dir / "absent.cfg").string()}, pool,
+                                        std::make_shared<cwparser::Interner>(), &failed);
+        success &= some.size() == 1 && failed.size() == 1 && failed[0] == (dir / "absent.cfg").string();
+
+        fs::remove_all(dir);
+        return success;
+    }
+
+    bool testSchemaValidation() {
+        setUp();
+        bool success = true;
+
+        cwparser::Schema schema;
+        schema.section("network.server").required<int>("port", 1, 65535).optional<std::string>("host");
+        schema.section("system").required<int>("threads", 1, 64).required<bool>("debug_mode").optional<double>("ratio");
+        schema.section("sensors.front").required<int>("rate");
+
+        cwparser::SchemaError error;
+        success &= parser.parse(test_file, schema, &error) && error.code == cwparser::ErrorCode::ok;
+        const cwparser::Value& threads = parser["system"].properties.find(cwparser::Key("threads"))->second;
+        const cwparser::Scalar& slot = parser["system"].typed(threads);
+        success &= slot.kind == cwparser::Scalar::Kind::integer && slot.integer == 4;
+        // Strings need no slot
+        success &= parser["network"]["server"].typed(parser["network"]["server"].properties.find("host")->second).kind ==
+                   cwparser::Scalar::Kind::none;
+        success &= parser["system"].get<int>("threads").value() == 4 && parser["system"].get<bool>("debug_mode").value();
+        success &= parser["network"]["server"].get<int>("port").value() == 8080;
+
+        // Out of range: parsing stops on the offending line
+        cwparser::Schema narrow;
+        narrow.section("network.server").required<int>("port", 1, 1024);
+        success &= !parser.parse(test_file, narrow, &error);
+        success &= error.code == cwparser::ErrorCode::out_of_range && error.line == 16 && error.column == 11;
+        success &= !parser.getRoot().child("coordinates");
+
+        cwparser::Schema typed;
+        typed.section("types_test").required<int>("string_value");
+        success &= !parser.parse(test_file, typed, &error) && error.code == cwparser::ErrorCode::invalid_value;
+
+        cwparser::Schema missing;
+        missing.section("graphics").required<int>("refresh_rate").required<int>("gamma");
+        success &= !parser.parse(test_file, missing, &error) && error.code == cwparser::ErrorCode::missing_key;
+        success &= error.section == "graphics" && error.key == "gamma" && error.line == 0;
+        cwparser::Schema absent;
+        absent.section("audio").optional<int>("balance").required<int>("volume");
+        success &= !parser.parse(test_file, absent, &error) && error.code == cwparser::ErrorCode::missing_key;
+        success &= error.section == "audio" && error.key == "volume";
+        cwparser::Schema nested;
+        nested.section("sensors.rear").required<int>("rate").required<int>("gain");
+        success &= !parser.parse(test_file, nested, &error) && error.section == "sensors.rear" && error.key == "gain";
+
+        // Ranges and declared types are checked on the full value, slots hold what the text says
+        cwparser::Schema ports;
+        ports.section("net").required<int>("port", 1, 65535);
+        std::istringstream wide("[net]\n    port: 4294975376\n");
+        success &= !parser.parse(wide, ports, &error) && error.code == cwparser::ErrorCode::out_of_range;
+        cwparser::Schema small;
+        small.section("net").optional<uint8_t>("ttl").optional<float>("ratio").optional<int>("offset");
+        std::istringstream narrow_text("[net]\n    ttl: 300\n");
+        success &= !parser.parse(narrow_text, small, &error) && error.code == cwparser::ErrorCode::out_of_range;
+        std::istringstream fitting("[net]\n    ttl: 200\n    ratio: 0.1\n    offset: -5\n");
+        success &= parser.parse(fitting, small, &error);
+        success &= parser["net"].get<int>("ttl").value() == 200 && parser["net"].get<uint8_t>("ttl").value() == 200;
+        success &= parser["net"].get<double>("ratio").value() == 0.1 && parser["net"].get<float>("ratio").value() == 0.1f;
+        success &= parser["net"].get<int>("offset").value() == -5;
+
+        tearDown();
+        return success;
+    }
+
+    bool testSharedMemoryPublication() {
+        setUp();
+        bool success = true;
+
+        success &= parser.parse(test_file);
+        const std::string name = "/cwparser_test_" + std::to_string(getpid());
+        cwparser::SharedPublisher publisher(name);
+        success &= publisher.publish(parser.freeze()) == 1;
+
+        // A separate process attaches read-only and serves lookups from the segment
+        pid_t child = fork();
+        if (child == 0) {
+            cwparser::SharedConfig shared(name);
+            bool ok = shared.generation() == 1 && shared["network"]["server"].get<int>("port").value() == 8080;
+            ok &= shared["system"].raw("debug_mode") == "true";
+            _exit(ok ? 0 : 1);
+        }
+        int status = 0;
+        success &= child > 0 && waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+        cwparser::SharedConfig reader(name);
+        cwparser::Frozen first = reader.current();
+        success &= !reader.refresh() && reader.generation() == 1;
+
+        parser["network"]["server"].setValue("port", "9090");
+        success &= publisher.publish(parser.freeze()) == 2;
+        success &= reader.refresh() && reader.generation() == 2;
+        success &= reader["network"]["server"].get<int>("port").value() == 9090;
+        // The replaced generation stays readable while it is held
+        success &= first["network"]["server"].get<int>("port").value() == 8080;
+
+        tearDown();
+        return success;
+    }
+
+    bool testLargeSectionIndex() {
+        bool success = true;
+
+        // One flat section well above the parallel threshold, every 100th key repeated later
+        std::stringstream text;
+        text << "[generated]\n";
+        for (int idx = 0; idx < 40000; idx++)
+            text << "    key" << idx << ": " << idx << "\n";
+        for (int idx = 0; idx < 40000; idx += 100)
+            text << "    key" << idx << ": override" << idx << "\n";
+        text << "    [nested]\n        port: 8080\n        port: 9090\n";
+        const std::string content = text.str();
+
+        cwparser::ThreadPool pool(4);
+        cwparser::cwparser batched;
+        std::istringstream in(content);
+        success &= batched.parse(in, pool);
+
+        cwparser::cwparser sequential;
+        std::istringstream again(content);
+        success &= sequential.parse(again);
+
+        cwparser::Node& node = batched["generated"];
+        success &= node.properties.size() == 40000;
+        success &= node.get<int>("key1").value() == 1 && node.get<int>("key39999").value() == 39999;
+        success &= node.get<std::string>("key300").value() == "override300" && node.get<std::string>("key0").value() == "override0";
+        success &= node["nested"].get<int>("port").value() == 9090;
+        // Sorted on the pool while storing, in the order a first query sorts them in
+        const auto& index = node.keyIndex();
+        const auto& expected_index = sequential["generated"].keyIndex();
+        success &= index.properties.size() == 40000 && index.children.size() == 1;
+        success &= std::equal(index.properties.begin(), index.properties.end(), expected_index.properties.begin(),
+                              [](const cwparser::Symbol& a, const cwparser::Symbol& b) { return a.view() == b.view(); });
+        success &= batched.getRoot().fingerprint() == sequential.getRoot().fingerprint();
+
+        auto expected = sequential["generated"].properties.begin();
+        for (const auto& prop : node.properties) {
+            success &= prop.first.view() == expected->first.view() && prop.second.text() == expected->second.text();
+            ++expected;
+        }
+        return success;
+    }
+
+    bool testEagerTyping() {
+        setUp();
+        bool success = true;
+
+        cwparser::cwparser eager;
+        eager.setEagerTyping(true);
+        success &= eager.parse(test_file);
+        success &= parser.parse(test_file);
+
+        using Kind = cwparser::Scalar::Kind;
+        auto kind = [&](const char* section, const char* key) {
+            return eager[section].typed(eager[section].properties.find(key)->second).kind;
+        };
+        success &= kind("system", "threads") == Kind::integer && kind("system", "hex_value") == Kind::integer;
+        success &= kind("system", "debug_mode") == Kind::boolean;
+        success &= kind("types_test", "float_value") == Kind::floating;
+        success &= kind("types_test", "string_value") == Kind::string;
+        success &= kind("types_test", "tuple_value") == Kind::tuple && kind("coordinates", "point1") == Kind::tuple;
+        success &= kind("types_test", "2d_vector") == Kind::array && kind("graphics", "resolution") == Kind::array;
+        success &= kind("malformed", "missingbr") == Kind::none;
+        success &= eager["network"]["server"].typed(eager["network"]["server"].properties.find("host")->second).kind == Kind::none;
+        success &= eager["system"].typed(eager["system"].properties.find("hex_value")->second).integer == 255;
+        // The lazy tree allocates no slot at all
+        success &= parser["system"].properties.find("hex_value")->second.slot == 0;
+
+        // Whatever the slot holds, every get reads what the lazy tree reads
+        const char* sections[] = {"system", "graphics", "coordinates", "types_test"};
+        for (const char* section : sections) {
+            for (const auto& prop : parser[section].properties) {
+                const cwparser::Key key(prop.first);
+                auto same = [&](auto sample) {
+                    using T = decltype(sample);
+                    auto lazy = parser[section].try_get<T>(key);
+                    auto typed = eager[section].try_get<T>(key);
+                    return lazy.has_value() == typed.has_value() && (!lazy.has_value() || *lazy == *typed);
+                };
+                success &= same(int{}) && same(long{}) && same(double{}) && same(float{}) && same(bool{}) &&
+                           same(std::string{}) && same(uint8_t{});
+            }
+        }
+        success &= *eager["types_test"].get<double>("int_value") == 42.0;
+        success &= *eager["types_test"].get<int>("float_value") == 3;
+
+        // Negative numbers are served from the slot too, unsigned targets fall back to the text
+        std::istringstream negative("[n]\n    offset: -5\n");
+        success &= eager.parse(negative);
+        cwparser::Value& offset = eager["n"].properties.find("offset")->second;
+        success &= eager["n"].typed(offset).kind == Kind::integer && eager["n"].typed(offset).integer == -5;
+        eager["n"].typedSlot(offset).integer = -6;
+        success &= eager["n"].get<int>("offset").value() == -6 && eager["n"].get<int8_t>("offset").value() == -6;
+        success &= eager["n"].get<unsigned>("offset").value() == static_cast<unsigned>(-5);
+
+        tearDown();
+        return success;
+    }
+
+    bool testSubtreeSharing() {
+        bool success = true;
+
+        std::stringstream text;
+        for (int idx = 0; idx < 200; idx++) {
+            text << "[device" << idx << "]\n    mode: default\n    table: [1, 2, 3, 4, 5, 6, 7, 8]\n";
+            text << "    [limits]\n        rate: " << (idx == 7 ? 50 : 100) << "\n";
+        }
+        cwparser::cwparser config;
+        std::istringstream in(text.str());
+        success &= config.parse(in);
+        const uint64_t fingerprint = config.getRoot().fingerprint();
+        const size_t before = config.freeze().bytes();
+
+        // 198 devices share device0, device7's limits differ so it keeps its own node but shares nothing
+        size_t shared = config.deduplicate();
+        success &= shared == 198 + 198;
+        success &= &config["device1"] == &config["device199"] && &config["device1"] == &config["device0"];
+        success &= &config["device7"] != &config["device0"];
+        success &= config["device7"]["limits"].get<int>("rate").value() == 50;
+        success &= config["device150"]["limits"].get<int>("rate").value() == 100;
+        success &= config.getRoot().fingerprint() == fingerprint;
+        success &= config.deduplicate() == 0;
+
+        // Long texts are one string across sections that differ, short ones stay inline
+        const cwparser::Value &table0 = config["device0"].properties.find("table")->second;
+        const cwparser::Value &table7 = config["device7"].properties.find("table")->second;
+        success &= table0.sharesText() && &table0.text() == &table7.text();
+        success &= !config["device7"].properties.find("mode")->second.sharesText();
+        success &= config["device7"].get<std::string>("table").value() == "[1, 2, 3, 4, 5, 6, 7, 8]";
+
+        // The frozen block stores each repeated value once
+        cwparser::Frozen frozen = config.freeze();
+        success &= frozen.bytes() == before && frozen["device42"].raw("table") == "[1, 2, 3, 4, 5, 6, 7, 8]";
+
+        // Versions still diverge where they are edited
+        auto edited = config.with_value("device3.mode", "custom");
+        success &= edited["device3"].get<std::string>("mode").value() == "custom";
+        success &= edited["device4"].get<std::string>("mode").value() == "default";
+        success &= config["device3"].get<std::string>("mode").value() == "default";
+
+        // Shared sections refuse edits that would reach every device, private ones and copies accept them
+        bool refused = false;
+        try {
+            config["device3"].setValue("mode", "custom");
+        } catch (const std::logic_error&) {
+            refused = true;
+        }
+        success &= refused && config["device4"].get<std::string>("mode").value() == "default";
+        success &= config["device3"]["limits"].isShared() && !config["device7"].isShared();
+        config["device7"].setValue("mode", "custom");
+        success &= config["device7"].get<std::string>("mode").value() == "custom";
+        config["device7"].setValue("table", "[8, 7, 6, 5, 4, 3, 2, 1]");
+        success &= !table7.sharesText() && table0.text() == "[1, 2, 3, 4, 5, 6, 7, 8]";
+        success &= !edited["device3"].isShared() && edited["device4"].isShared();
+        edited["device3"].setValue("mode", "tuned");
+        success &= edited["device3"].get<std::string>("mode").value() == "tuned";
+        return success;
+    }
+
+    bool testNumericArrays() {
+        bool success = true;
+
+        // Plain numbers take the fast path, the odd ones fall back, all must read like single values
+        std::vector<std::string> samples = {"0", "-0", "7", " 42 ", "-123456789012", "999999999999999999",
+            "1234567890123456789", "0x1F", "+5", "007", "12abc", "3.25", "-0.0", "1e5", "2.5E-3", "1e-22",
+            "1.7976931348623157e308", "4.9e-324", "0.1", "123456.789012", "9007199254740993", "1.", ".5",
+            "-", "", "inf", "6.02214076e23", "12345678901234567890.5", "1e", " -17 ", "8\t"};
+        std::mt19937 random(42);
+        std::string text = "[";
+        std::vector<std::string> elements;
+        for (int idx = 0; idx < 20000; idx++) {
+            std::string element;
+            switch (random() % 4) {
+            case 0: element = std::to_string(static_cast<long>(random()) - 2147483647); break;
+            case 1: element = std::to_string(random() % 100000) + "." + std::to_string(random() % 1000); break;
+            case 2: element = std::to_string(static_cast<int64_t>(random()) * 99991); break;
+            default: element = samples[random() % samples.size()]; break;
+            }
+            elements.push_back(element);
+            text += (idx ? "," : "") + element;
+        }
+        text += "]";
+
+        auto same = [&](auto sample) {
+            using T = decltype(sample);
+            std::vector<T> all;
+            cwparser::Error error = cwparser::_::locate({}, cwparser::_::try_from_string(text, all));
+            std::vector<T> expected;
+            for (const auto& element : elements) {
+                T value{};
+                auto status = cwparser::_::try_from_string(element, value);
+                if (!status)
+                    return error.code == status.code && all.size() == expected.size() + 1;
+                expected.push_back(value);
+            }
+            if (error.code != cwparser::ErrorCode::ok || all.size() != expected.size())
+                return false;
+            for (size_t idx = 0; idx < all.size(); idx++) {
+                if (std::memcmp(&all[idx], &expected[idx], sizeof(T)) != 0)
+                    return false;
+            }
+            return true;
+        };
+        // Elements that are not numbers stop the vector at the first one, keep only the valid samples for a full pass
+        success &= same(int{}) && same(int64_t{}) && same(double{}) && same(float{}) && same(uint16_t{});
+        samples = {"0", "-0", "7", " 42 ", "-123456789012", "0x1F", "+5", "007", "12abc", "3.25", "-0.0", "1e5",
+                   "2.5E-3", "1e-22", "1.7976931348623157e308", "4.9e-324", "0.1", "9007199254740993", "1.",
+                   "6.02214076e23", "1e", " -17 ", "8\t"};
+        elements.clear();
+        text = "[";
+        for (int idx = 0; idx < 20000; idx++) {
+            std::string element = idx % 3 ? std::to_string(static_cast<long>(random()) - 2147483647)
+                                          : samples[random() % samples.size()];
+            elements.push_back(element);
+            text += (idx ? "," : "") + element;
+        }
+        text += "]";
+        success &= same(int{}) && same(int64_t{}) && same(double{}) && same(float{}) && same(uint16_t{});
+
+        // Every instruction set the CPU has agrees with the scalar kernels
+        const std::string digits = "12345678901234567890123456789012345678901234567890x,1,2,,3";
+        for (int level = 0; level <= static_cast<int>(cwparser::_::simdLevel()); level++) {
+            auto simd = static_cast<cwparser::_::SimdLevel>(level);
+            for (size_t start = 0; start < digits.size(); start++) {
+                const char* begin = digits.data() + start;
+                const char* end = digits.data() + digits.size();
+                success &= cwparser::_::digitRun(begin, end, simd) == cwparser::_::digitRun(begin, end, cwparser::_::SimdLevel::scalar);
+                success &= cwparser::_::countByte(begin, end, ',', simd) == static_cast<size_t>(std::count(begin, end, ','));
+            }
+        }
+        return success;
+    }
+
+    bool testKeyFilter() {
+        bool success = true;
+
+        std::stringstream text;
+        text << "[features]\n";
+        for (int idx = 0; idx < 1000; idx++)
+            text << "    flag" << idx << ": " << idx % 2 << "\n";
+        text << "    [nested]\n        port: 8080\n";
+
+        cwparser::cwparser config;
+        config.setKeyFilter(true);
+        std::istringstream in(text.str());
+        success &= config.parse(in);
+
+        cwparser::Node& features = config["features"];
+        for (int idx = 0; idx < 1000; idx++)
+            success &= features.get<int>("flag" + std::to_string(idx)).value() == idx % 2;
+        success &= features["nested"].get<int>("port").value() == 8080;
+
+        // Absent names: always reported missing, and nearly all of them stopped by the filter
+        size_t passed = 0;
+        for (int idx = 0; idx < 100000; idx++) {
+            const std::string name = "override" + std::to_string(idx);
+            passed += features.mayContain(name);
+            success &= !features.get<int>(name).has_value();
+            success &= features.try_get<int>(name).error().code == cwparser::ErrorCode::missing_key;
+        }
+        success &= passed < 3000;
+        success &= !config.getRoot().mayContain("absent") && config.getRoot().mayContain("features");
+
+        // Names added afterwards are let through
+        features.setValue("override7", "on");
+        success &= features.get<bool>("override7").value();
+        features.setChild("extra", std::make_shared<cwparser::Node>(config.getInterner()));
+        success &= bool(features["extra"]);
+
+        // Without the option nothing is filtered
+        cwparser::cwparser plain;
+        std::istringstream again(text.str());
+        success &= plain.parse(again) && plain["features"].mayContain("override1");
+        return success;
+    }
+
+    bool testConcurrentMutation() {
+        setUp();
+        bool success = true;
+
+        cwparser::cwparser live;
+        live.setConcurrent(true);
+        success &= live.parse(test_file);
+        cwparser::Node& server = live["network"]["server"];
+        cwparser::Node& sensors = live["sensors"];
+
+        // Workers read while the control thread retunes values, adds keys and swaps sections
+        std::atomic<bool> done{false};
+        std::atomic<size_t> reads{0}, bad{0};
+        std::vector<std::thread> workers;
+        for (int idx = 0; idx < 4; idx++) {
+            workers.emplace_back([&] {
+                int last = 0;
+                while (!done.load()) {
+                    auto read = server.get<int>("port");
+                    int port = read.has_value() ? *read : -1;
+                    if (port < last)
+                        bad++;
+                    last = port;
+                    auto rate = sensors.child("front")->try_get<int>("rate");
+                    if (!rate.has_value() || (*rate != 100 && *rate != 200))
+                        bad++;
+                    server.get<int>("tuned_" + std::to_string(port % 8));
+                    reads++;
+                }
+            });
+        }
+
+        for (int port = 8081; port <= 10000; port++) {
+            server.setValue("port", std::to_string(port));
+            server.setValue("tuned_" + std::to_string(port % 8), std::to_string(port));
+            if (port % 100 == 0) {
+                auto front = std::make_shared<cwparser::Node>(live.getInterner());
+                front->setValue("rate", port % 200 == 0 ? "200" : "100");
+                sensors.setChild("front", front);
+            }
+        }
+        while (reads.load() < 1000)
+            std::this_thread::yield();
+        done = true;
+        for (auto& worker : workers)
+            worker.join();
+
+        success &= bad.load() == 0;
+        success &= server.get<int>("port").value() == 10000 && server.get<int>("tuned_0").value() == 10000;
+        success &= sensors["front"].get<int>("rate").value() == 200;
+
+        // A replaced section is freed once its last holder lets go
+        std::weak_ptr<cwparser::Node> replaced = sensors.child("front");
+        auto held = sensors.child("front");
+        sensors.setChild("front", std::make_shared<cwparser::Node>(live.getInterner()));
+        success &= !replaced.expired() && held->get<int>("rate").value() == 200;
+        success &= sensors.child("front")->tree->lock == sensors.tree->lock && !sensors.child("missing");
+        held.reset();
+        success &= replaced.expired();
+
+        // Versions carry a lock of their own
+        auto version = live.with_value("network.server.port", "7000");
+        success &= version["network"]["server"].tree->lock && version["network"]["server"].tree->lock != server.tree->lock;
+        success &= version["network"]["server"].get<int>("port").value() == 7000;
+        success &= !parser.getRoot().tree->lock;
+
+        tearDown();
+        return success;
+    }
 };
 
 int main(int argc, char **argv) {
@@ -304,6 +1280,48 @@ int main(int argc, char **argv) {
     { framework.addTest("nested_key_traversal", std::bind(&cwparser_test::testNestedKeyTraversal, &tests)); };
     if( test_name == "malformed_input_handling" || all ) 
     { framework.addTest("malformed_input_handling", std::bind(&cwparser_test::testMalformedInputHandling, &tests)); };
+    if( test_name == "non_throwing_access" || all ) 
+    { framework.addTest("non_throwing_access", std::bind(&cwparser_test::testNonThrowingAccess, &tests)); };
+    if( test_name == "key_interning" || all ) 
+    { framework.addTest("key_interning", std::bind(&cwparser_test::testKeyInterning, &tests)); };
+    if( test_name == "precomputed_keys" || all ) 
+    { framework.addTest("precomputed_keys", std::bind(&cwparser_test::testPrecomputedKeys, &tests)); };
+    if( test_name == "wildcard_queries" || all ) 
+    { framework.addTest("wildcard_queries", std::bind(&cwparser_test::testWildcardQueries, &tests)); };
+    if( test_name == "frozen_lookups" || all ) 
+    { framework.addTest("frozen_lookups", std::bind(&cwparser_test::testFrozenLookups, &tests)); };
+    if( test_name == "parallel_bulk_conversion" || all ) 
+    { framework.addTest("parallel_bulk_conversion", std::bind(&cwparser_test::testParallelBulkConversion, &tests)); };
+    if( test_name == "bracketed_tuple_parsing" || all ) 
+    { framework.addTest("bracketed_tuple_parsing", std::bind(&cwparser_test::testBracketedTupleParsing, &tests)); };
+    if( test_name == "subtree_diff" || all ) 
+    { framework.addTest("subtree_diff", std::bind(&cwparser_test::testSubtreeDiff, &tests)); };
+    if( test_name == "streaming_scan" || all ) 
+    { framework.addTest("streaming_scan", std::bind(&cwparser_test::testStreamingScan, &tests)); };
+    if( test_name == "copy_on_write" || all ) 
+    { framework.addTest("copy_on_write", std::bind(&cwparser_test::testCopyOnWrite, &tests)); };
+    if( test_name == "enum_and_bool_parsing" || all ) 
+    { framework.addTest("enum_and_bool_parsing", std::bind(&cwparser_test::testEnumAndBoolParsing, &tests)); };
+    if( test_name == "reference_interpolation" || all ) 
+    { framework.addTest("reference_interpolation", std::bind(&cwparser_test::testReferenceInterpolation, &tests)); };
+    if( test_name == "batch_loading" || all ) 
+    { framework.addTest("batch_loading", std::bind(&cwparser_test::testBatchLoading, &tests)); };
+    if( test_name == "schema_validation" || all ) 
+    { framework.addTest("schema_validation", std::bind(&cwparser_test::testSchemaValidation, &tests)); };
+    if( test_name == "shared_memory_publication" || all ) 
+    { framework.addTest("shared_memory_publication", std::bind(&cwparser_test::testSharedMemoryPublication, &tests)); };
+    if( test_name == "large_section_index" || all ) 
+    { framework.addTest("large_section_index", std::bind(&cwparser_test::testLargeSectionIndex, &tests)); };
+    if( test_name == "eager_typing" || all ) 
+    { framework.addTest("eager_typing", std::bind(&cwparser_test::testEagerTyping, &tests)); };
+    if( test_name == "subtree_sharing" || all ) 
+    { framework.addTest("subtree_sharing", std::bind(&cwparser_test::testSubtreeSharing, &tests)); };
+    if( test_name == "numeric_arrays" || all ) 
+    { framework.addTest("numeric_arrays", std::bind(&cwparser_test::testNumericArrays, &tests)); };
+    if( test_name == "key_filter" || all ) 
+    { framework.addTest("key_filter", std::bind(&cwparser_test::testKeyFilter, &tests)); };
+    if( test_name == "concurrent_mutation" || all ) 
+    { framework.addTest("concurrent_mutation", std::bind(&cwparser_test::testConcurrentMutation, &tests)); };
 
     return framework.runTests() ? 0 : 1;
 } 
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Simple test framework
+class TestFramework {
+private:
+    struct TestCase {
+        std::string name;
+        std::function<bool()> test;
+    };
+    std::vector<TestCase> tests;
+    int passed = 0;
+    int failed = 0;
+
+    void printResult(const std::string& name, bool success) {
+        if (success) {
+            std::cout << "\033[32m[PASS]\033[0m " << name << std::endl;
+            passed++;
+        } else {
+            std::cout << "\033[31m[FAIL]\033[0m " << name << std::endl;
+            failed++;
+        }
+    }
+
+public:
+    void addTest(const std::string& name, std::function<bool()> test) {
+        tests.push_back({name, test});
+    }
+
+    bool runTests() {
+        for (const auto& test : tests) {
+            try {
+                bool result = test.test();
+                printResult(test.name, result);
+            } catch (const std::exception& e) {
+                std::cout << "\033[31m[EXCEPTION]\033[0m in " << test.name << ": " << e.what() << std::endl;
+                failed++;
+            }
+        }
+        
+        std::cout << "\nTest Summary:\n";
+        std::cout << "Passed: " << passed << "\n";
+        std::cout << "Failed: " << failed << "\n";
+        std::cout << "Total:  " << tests.size() << "\n";
+        
+        return failed == 0;
+    }
+};
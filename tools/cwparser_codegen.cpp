@@ -0,0 +1,518 @@
+// cwparser-codegen: turn a sample configuration into a header with plain structs and a loader
+// specialized to that layout. The generated code does not depend on cwparser.
+//
+//   cwparser-codegen <sample.cfg> <output.hpp> [namespace]
+//
+// Field types are inferred from the sample values: booleans, integers (decimal or 0x), floating
+// point numbers, flat numeric arrays, everything else is kept as a string.
+
+#include "cwparser/cwparser.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+enum class FieldType
+{
+	boolean,
+	integer,
+	floating,
+	integers,
+	floatings,
+	text
+};
+
+struct Field
+{
+	std::string key;
+	std::string name;
+	FieldType type;
+};
+
+struct Section
+{
+	std::string key;
+	std::string name;
+	std::string type;
+	int id;
+	std::vector<Field> fields;
+	std::vector<Section> children;
+};
+
+// Keywords up to C++20 and the alternative operator tokens, none of them can name a member
+bool isKeyword(const std::string &name)
+{
+	static const char *keywords[] = {"alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool",
+		"break", "case", "catch", "char", "char8_t", "char16_t", "char32_t", "class", "co_await", "co_return",
+		"co_yield", "compl", "concept", "const", "const_cast", "consteval", "constexpr", "constinit", "continue",
+		"decltype", "default", "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit", "export",
+		"extern", "false", "float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace",
+		"new", "noexcept", "not", "not_eq", "nullptr", "operator", "or", "or_eq", "private", "protected", "public",
+		"register", "reinterpret_cast", "requires", "return", "short", "signed", "sizeof", "static",
+		"static_assert", "static_cast", "struct", "switch", "template", "this", "thread_local", "throw", "true",
+		"try", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual", "void", "volatile",
+		"wchar_t", "while", "xor", "xor_eq"};
+	return std::find(std::begin(keywords), std::end(keywords), name) != std::end(keywords);
+}
+
+std::string identifier(std::string_view text)
+{
+	std::string name;
+	for (char c : text)
+		name += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+	if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0])))
+		name.insert(0, "_");
+	if (isKeyword(name))
+		name += '_';
+	return name;
+}
+
+std::string typeName(std::string_view text)
+{
+	std::string name;
+	bool upper = true;
+	for (char c : text)
+	{
+		if (!std::isalnum(static_cast<unsigned char>(c)))
+		{
+			upper = true;
+			continue;
+		}
+		name += upper ? static_cast<char>(std::toupper(static_cast<unsigned char>(c))) : c;
+		upper = false;
+	}
+	if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0])))
+		name.insert(0, "S");
+	return name + "Section";
+}
+
+// Members of one struct share a scope: a-b and a_b, or a field and a section both called port, would
+// clash, as would a member named after the struct itself. Later ones get a numeric suffix.
+std::string unique(const std::string &name, std::set<std::string> &used)
+{
+	std::string candidate = name;
+	for (int count = 2; !used.insert(candidate).second; count++)
+		candidate = name + "_" + std::to_string(count);
+	return candidate;
+}
+
+template <typename T>
+bool converts(std::string_view text)
+{
+	T value{};
+	return bool(cwparser::_::try_from_string(text, value));
+}
+
+bool isInteger(std::string_view text)
+{
+	text = cwparser::_::trim(text);
+	size_t pos = text.size() > 0 && (text[0] == '-' || text[0] == '+') ? 1 : 0;
+	bool hex = text.size() > pos + 2 && text[pos] == '0' && (text[pos + 1] == 'x' || text[pos + 1] == 'X');
+	if (hex)
+		pos += 2;
+	if (pos == text.size())
+		return false;
+	for (; pos < text.size(); pos++)
+	{
+		if (!(hex ? std::isxdigit(static_cast<unsigned char>(text[pos])) : std::isdigit(static_cast<unsigned char>(text[pos]))))
+			return false;
+	}
+	return true;
+}
+
+bool isFloating(std::string_view text)
+{
+	text = cwparser::_::trim(text);
+	if (text.empty())
+		return false;
+	double value = 0;
+	size_t pos = text[0] == '+' ? 1 : 0;
+	auto res = std::from_chars(text.data() + pos, text.data() + text.size(), value);
+	return res.ec == std::errc() && res.ptr == text.data() + text.size();
+}
+
+FieldType infer(std::string_view text)
+{
+	text = cwparser::_::trim(text);
+	if (text.size() >= 2 && text.front() == '[' && text.back() == ']' && text.find('[', 1) == std::string_view::npos)
+	{
+		std::string_view inner = text.substr(1, text.size() - 2);
+		bool integers = true, numbers = !cwparser::_::trim(inner).empty();
+		size_t start = 0;
+		while (numbers && start <= inner.size())
+		{
+			size_t comma = std::min(inner.find(',', start), inner.size());
+			std::string_view element = inner.substr(start, comma - start);
+			integers &= isInteger(element);
+			numbers &= integers || isFloating(element);
+			start = comma + 1;
+		}
+		if (numbers)
+			return integers ? FieldType::integers : FieldType::floatings;
+		return FieldType::text;
+	}
+	if (text.find(' ') == std::string_view::npos && converts<bool>(text) && !isInteger(text))
+		return FieldType::boolean;
+	if (isInteger(text))
+		return FieldType::integer;
+	if (isFloating(text))
+		return FieldType::floating;
+	return FieldType::text;
+}
+
+const char *cppType(FieldType type)
+{
+	switch (type)
+	{
+	case FieldType::boolean:   return "bool";
+	case FieldType::integer:   return "long";
+	case FieldType::floating:  return "double";
+	case FieldType::integers:  return "std::vector<long>";
+	case FieldType::floatings: return "std::vector<double>";
+	case FieldType::text:      return "std::string";
+	}
+	return "std::string";
+}
+
+const char *initializer(FieldType type)
+{
+	switch (type)
+	{
+	case FieldType::boolean:  return " = false";
+	case FieldType::integer:  return " = 0";
+	case FieldType::floating: return " = 0.0";
+	default:                  return "";
+	}
+}
+
+Section describe(const cwparser::Node &node, std::string_view key, std::string name, std::string type, int &next_id)
+{
+	Section section{std::string(key), std::move(name), std::move(type), next_id++, {}, {}};
+	std::set<std::string> used{section.type};
+	const auto &index = node.keyIndex();
+	for (const auto &child : index.children)
+	{
+		std::string child_type = unique(typeName(child.view()), used);
+		std::string child_name = unique(identifier(child.view()), used);
+		section.children.push_back(describe(*node.children.find(child)->second, child.view(), std::move(child_name),
+											std::move(child_type), next_id));
+	}
+	for (const auto &prop : index.properties)
+	{
+		const cwparser::Value &value = node.properties.find(prop)->second;
+		section.fields.push_back({prop.str(), unique(identifier(prop.view()), used), infer(value.text())});
+	}
+	return section;
+}
+
+std::string literal(const std::string &text)
+{
+	std::string quoted = "\"";
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+			quoted += '\\';
+		quoted += c;
+	}
+	return quoted + "\"";
+}
+
+std::string indent(int depth)
+{
+	return std::string(depth * 4, ' ');
+}
+
+void emitStruct(std::ostream &out, const Section &section, int depth)
+{
+	out << indent(depth) << "struct " << section.type << "\n" << indent(depth) << "{\n";
+	for (const auto &child : section.children)
+		emitStruct(out, child, depth + 1);
+	for (const auto &child : section.children)
+		out << indent(depth + 1) << child.type << " " << child.name << ";\n";
+	for (const auto &field : section.fields)
+		out << indent(depth + 1) << cppType(field.type) << " " << field.name << initializer(field.type) << ";\n";
+	out << indent(depth) << "};\n\n";
+}
+
+/**
+ * Dispatch on length first, then on the first character, then confirm with memcmp.
+ */
+template <typename Entry, typename Emit>
+void emitSwitch(std::ostream &out, const std::string &var, std::vector<const Entry *> entries, int depth, Emit emit)
+{
+	std::sort(entries.begin(), entries.end(), [](const Entry *a, const Entry *b) {
+		return std::make_pair(a->key.size(), a->key) < std::make_pair(b->key.size(), b->key);
+	});
+	out << indent(depth) << "switch (" << var << ".size())\n" << indent(depth) << "{\n";
+	for (size_t idx = 0; idx < entries.size();)
+	{
+		size_t length = entries[idx]->key.size();
+		out << indent(depth) << "case " << length << ":\n";
+		if (length == 0)
+		{
+			emit(*entries[idx], depth + 1);
+			while (idx < entries.size() && entries[idx]->key.empty())
+				idx++;
+			continue;
+		}
+		out << indent(depth + 1) << "switch (static_cast<unsigned char>(" << var << "[0]))\n" << indent(depth + 1) << "{\n";
+		for (; idx < entries.size() && entries[idx]->key.size() == length;)
+		{
+			char first = entries[idx]->key[0];
+			out << indent(depth + 1) << "case ";
+			if (std::isalnum(static_cast<unsigned char>(first)) || first == '_')
+				out << "'" << first << "':\n";
+			else
+				out << int(static_cast<unsigned char>(first)) << ":\n";
+			for (; idx < entries.size() && entries[idx]->key.size() == length && entries[idx]->key[0] == first; idx++)
+			{
+				out << indent(depth + 2) << "if (std::memcmp(" << var << ".data(), " << literal(entries[idx]->key) << ", "
+					<< length << ") == 0)\n";
+				out << indent(depth + 2) << "{\n";
+				emit(*entries[idx], depth + 3);
+				out << indent(depth + 2) << "}\n";
+			}
+			out << indent(depth + 2) << "break;\n";
+		}
+		out << indent(depth + 1) << "}\n" << indent(depth + 1) << "break;\n";
+	}
+	out << indent(depth) << "}\n";
+}
+
+void collect(const Section &section, const std::string &access, std::vector<std::pair<const Section *, std::string>> &all)
+{
+	all.emplace_back(&section, access);
+	for (const auto &child : section.children)
+		collect(child, access + "." + child.name, all);
+}
+
+void emitLoader(std::ostream &out, const Section &root)
+{
+	std::vector<std::pair<const Section *, std::string>> all;
+	collect(root, "config", all);
+
+	out << "    // Section reached from parent by name, -1 when not part of the layout\n";
+	out << "    inline int child(int parent, std::string_view name)\n    {\n";
+	out << "        switch (parent)\n        {\n";
+	for (const auto &entry : all)
+	{
+		if (entry.first->children.empty())
+			continue;
+		out << "        case " << entry.first->id << ":\n        {\n";
+		std::vector<const Section *> children;
+		for (const auto &child : entry.first->children)
+			children.push_back(&child);
+		emitSwitch(out, "name", children, 3, [&](const Section &child, int depth) {
+			out << indent(depth) << "return " << child.id << ";\n";
+		});
+		out << "            break;\n        }\n";
+	}
+	out << "        }\n        return -1;\n    }\n\n";
+
+	out << "    // Returns false when value does not convert to the field type\n";
+	out << "    inline bool assign(Config &config, int section, std::string_view key, std::string_view value)\n    {\n";
+	out << "        switch (section)\n        {\n";
+	for (const auto &entry : all)
+	{
+		if (entry.first->fields.empty())
+			continue;
+		out << "        case " << entry.first->id << ":\n        {\n";
+		std::vector<const Field *> fields;
+		for (const auto &field : entry.first->fields)
+			fields.push_back(&field);
+		emitSwitch(out, "key", fields, 3, [&](const Field &field, int depth) {
+			out << indent(depth) << "return convert(value, " << entry.second << "." << field.name << ");\n";
+		});
+		out << "            break;\n        }\n";
+	}
+	out << "        }\n        return true;\n    }\n";
+}
+
+const char *runtime = R"(    inline std::string_view trim(std::string_view text)
+    {
+        size_t start = text.find_first_not_of(" \t\r");
+        if (start == std::string_view::npos)
+            return text.substr(text.size());
+        return text.substr(start, text.find_last_not_of(" \t\r") - start + 1);
+    }
+
+    // Leading blanks as cwparser counts them, a tab is worth four spaces
+    inline size_t indentation(std::string_view line)
+    {
+        size_t width = 0;
+        for (size_t pos = 0; pos < line.size() && (line[pos] == ' ' || line[pos] == '\t'); pos++)
+            width += line[pos] == '\t' ? 4 : 1;
+        return width;
+    }
+
+    inline bool convert(std::string_view text, long &out)
+    {
+        text = trim(text);
+        size_t pos = 0;
+        bool negative = false;
+        if (pos < text.size() && (text[pos] == '-' || text[pos] == '+'))
+            negative = text[pos++] == '-';
+        int base = 10;
+        if (pos + 1 < text.size() && text[pos] == '0' && (text[pos + 1] == 'x' || text[pos + 1] == 'X'))
+        {
+            base = 16;
+            pos += 2;
+        }
+        unsigned long magnitude = 0;
+        auto res = std::from_chars(text.data() + pos, text.data() + text.size(), magnitude, base);
+        if (res.ec != std::errc() || magnitude > static_cast<unsigned long>(std::numeric_limits<long>::max()) + negative)
+            return false;
+        out = negative ? static_cast<long>(0ul - magnitude) : static_cast<long>(magnitude);
+        return true;
+    }
+
+    inline bool convert(std::string_view text, double &out)
+    {
+        text = trim(text);
+        size_t pos = !text.empty() && text[0] == '+' ? 1 : 0;
+        return std::from_chars(text.data() + pos, text.data() + text.size(), out).ec == std::errc();
+    }
+
+    inline bool convert(std::string_view text, bool &out)
+    {
+        text = trim(text);
+        std::string word(text);
+        for (char &c : word)
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        out = word == "true" || word == "yes" || word == "on" || word == "1";
+        return out || word == "false" || word == "no" || word == "off" || word == "0";
+    }
+
+    inline bool convert(std::string_view text, std::string &out)
+    {
+        auto first = text.find('"'), second = text.find('"', first + 1);
+        if (first != std::string_view::npos && second != std::string_view::npos)
+            out.assign(text.substr(first + 1, second - first - 1));
+        else
+            out.assign(text);
+        return true;
+    }
+
+    template <typename T>
+    bool convert(std::string_view text, std::vector<T> &out)
+    {
+        text = trim(text);
+        if (text.size() < 2 || text.front() != '[' || text.back() != ']')
+            return false;
+        text = text.substr(1, text.size() - 2);
+        out.clear();
+        if (trim(text).empty())
+            return true;
+        for (size_t start = 0; start <= text.size();)
+        {
+            size_t comma = std::min(text.find(',', start), text.size());
+            T value{};
+            if (!convert(text.substr(start, comma - start), value))
+                return false;
+            out.push_back(value);
+            start = comma + 1;
+        }
+        return true;
+    }
+
+)";
+
+const char *entry = R"(} // namespace detail
+
+/**
+ * @brief Fill config from the text, same format and indentation rules as cwparser::parse.
+ *        Sections and keys outside the layout are skipped. On a bad value bad_line receives its line.
+ */
+inline bool load(std::istream &in, Config &config, size_t *bad_line = nullptr)
+{
+    std::vector<int> sections;
+    std::string buffer;
+    size_t line_no = 0;
+    while (std::getline(in, buffer))
+    {
+        line_no++;
+        std::string_view line = buffer;
+        size_t indent = detail::indentation(line);
+        std::string_view text = detail::trim(line);
+        if (text.empty() || text[0] == '#')
+            continue;
+
+        size_t colon = text.find(':');
+        if (colon != std::string_view::npos && !sections.empty())
+        {
+            if (sections.back() >= 0 &&
+                !detail::assign(config, sections.back(), detail::trim(text.substr(0, colon)), detail::trim(text.substr(colon + 1))))
+            {
+                if (bad_line != nullptr)
+                    *bad_line = line_no;
+                return false;
+            }
+            continue;
+        }
+        while (!sections.empty() && sections.size() > indent / 4)
+            sections.pop_back();
+        if (text[0] == '[' && text.back() == ']')
+        {
+            int parent = sections.empty() ? 0 : sections.back();
+            std::string_view name = text.substr(1, text.size() - 2);
+            sections.push_back(parent < 0 ? -1 : detail::child(parent, name));
+        }
+    }
+    return !in.bad();
+}
+
+inline bool load(const std::string &filename, Config &config, size_t *bad_line = nullptr)
+{
+    std::ifstream file(filename, std::ios::binary);
+    return file.is_open() && load(file, config, bad_line);
+}
+
+)";
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3)
+	{
+		std::cerr << "usage: cwparser-codegen <sample.cfg> <output.hpp> [namespace]" << std::endl;
+		return 2;
+	}
+	std::string sample = argv[1], output = argv[2];
+	std::string ns = argc > 3 ? argv[3] : "config";
+
+	cwparser::cwparser parser;
+	if (!parser.parse(sample))
+		return 1;
+
+	int next_id = 0;
+	Section root = describe(parser.getRoot(), "", "config", "Config", next_id);
+
+	std::ostringstream out;
+	out << "#pragma once\n\n";
+	out << "// Generated by cwparser-codegen from " << sample.substr(sample.find_last_of("/\\") + 1) << ", do not edit.\n\n";
+	out << "#include <algorithm>\n#include <cctype>\n#include <charconv>\n#include <cstring>\n#include <fstream>\n"
+		<< "#include <istream>\n#include <limits>\n#include <string>\n#include <string_view>\n#include <vector>\n\n";
+	out << "namespace " << ns << "\n{\n\n";
+	emitStruct(out, root, 0);
+	out << "namespace detail\n{\n\n" << runtime;
+	emitLoader(out, root);
+	out << "\n" << entry << "} // namespace " << ns << "\n";
+
+	std::ofstream file(output, std::ios::binary);
+	file << out.str();
+	if (!file)
+	{
+		std::cerr << "Failed to write " << output << std::endl;
+		return 1;
+	}
+	return 0;
+}